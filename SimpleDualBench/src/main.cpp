@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+/**
+ * @file
+ * Runs the core microbenchmarks, see Benchmark.h.
+ *
+ * Usage: SimpleDualBench [-trace file] [benchmark...]
+ * Without benchmark names all benchmarks run, otherwise only the named
+ * ones. -trace replays a memory trace recorded by StartMemoryTrace() in a
+ * MEMORY_TRACKING build instead of the generated one.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "SystemCore.h"
+#include "Benchmark.h"
+
+typedef struct BenchmarkEntryStruct
+{
+    char const *name;
+    void (*run)(void);
+} BenchmarkEntry;
+
+static void RunTripleBufferSwap(void)
+{
+    System::Benchmark::TripleBufferSwap(1000000);
+}
+
+static void RunBTrieLookup(void)
+{
+    System::Benchmark::BTrieLookup(1 << 20);
+}
+
+// memory trace given on the command line, null for the generated one
+static char const *g_MemoryTraceFileName = 0;
+
+static void RunMemoryAllocTrace(void)
+{
+    System::Benchmark::MemoryAllocTrace(300, 4, g_MemoryTraceFileName);
+}
+
+static void RunManagedPtrRefCount(void)
+{
+    System::Benchmark::ManagedPtrRefCount(10000000, 4);
+}
+
+static BenchmarkEntry const g_Benchmarks[] =
+{
+    { "triplebuffer", &RunTripleBufferSwap },
+    { "btrie", &RunBTrieLookup },
+    { "alloc", &RunMemoryAllocTrace },
+    { "refcount", &RunManagedPtrRefCount }
+};
+
+static int const g_BenchmarkCount = sizeof(g_Benchmarks) / sizeof(g_Benchmarks[0]);
+
+// the default log output is compiled for the platform defines only
+static void PrintLog(int level, char const *str)
+{
+    (void)level;
+    puts(str);
+    fflush(stdout);
+}
+
+static void PrintUsage(void)
+{
+    printf("usage: SimpleDualBench [-trace file] [benchmark...]\nbenchmarks:");
+    for (int i = 0; i < g_BenchmarkCount; i++)
+    {
+        printf(" %s", g_Benchmarks[i].name);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    System::SetNativeLogBufferDump(&PrintLog);
+
+    bool selected[g_BenchmarkCount];
+    bool anySelected = false;
+    for (int i = 0; i < g_BenchmarkCount; i++)
+    {
+        selected[i] = false;
+    }
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (strcmp(argv[arg], "-trace") == 0)
+        {
+            if (++arg == argc)
+            {
+                PrintUsage();
+                return 1;
+            }
+            g_MemoryTraceFileName = argv[arg];
+            continue;
+        }
+
+        int i = 0;
+        while (i < g_BenchmarkCount && strcmp(argv[arg], g_Benchmarks[i].name) != 0)
+        {
+            i++;
+        }
+
+        if (i == g_BenchmarkCount)
+        {
+            PrintUsage();
+            return 1;
+        }
+        selected[i] = true;
+        anySelected = true;
+    }
+
+    for (int i = 0; i < g_BenchmarkCount; i++)
+    {
+        if (selected[i] || !anySelected)
+        {
+            printf("== %s\n", g_Benchmarks[i].name);
+            g_Benchmarks[i].run();
+        }
+    }
+
+    return 0;
+}
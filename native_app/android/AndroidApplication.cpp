@@ -6,11 +6,14 @@
 #include <nv_egl_util/nv_egl_util.h>
 #include <GLES2/gl2.h>
 #include <sys/stat.h>
+#include <sys/system_properties.h>
 #include <errno.h>
 #include <memory>
 #include "AndroidApplication.h"
 #include "Application.h"
 #include "DeviceProxy.h"
+#include "InputRecord.h"
+#include "ReplayDriver.h"
 
 static int MakeDir(std::string const &path, mode_t mode)
 {
@@ -60,7 +63,7 @@ static bool MakePath(std::string const &path, mode_t mode)
 
 System::Internal::AndroidApplication::AndroidApplication(android_app *app, NvEGLUtil *egl)
         : mNativeAppInstance(app), mEgl(egl), mCurrentApplication(0), mCurrentApplicationState(Initialization),
-          mPreviousDigitalCrossState(0)
+          mPreviousDigitalCrossState(0), mReplayingInput(false)
 {
     app->userData = this;
     app->onAppCmd = HandleCmd;
@@ -141,7 +144,7 @@ int System::Internal::AndroidApplication::HandleInput(android_app *app, AInputEv
 int System::Internal::AndroidApplication::handleInput(AInputEvent *event)
 {
     //We only handle motion events (touchscreen) and key (button/key) events
-    if (mCurrentApplication == 0)
+    if (mCurrentApplication == 0 || mReplayingInput)
     {
         return 0;
     }
@@ -246,6 +249,7 @@ int System::Internal::AndroidApplication::handleInput(AInputEvent *event)
                 {
                     int mx = AMotionEvent_getX(event, i);
                     int my = AMotionEvent_getY(event, i);
+                    deviceProxy->dispatchTouch(System::Internal::DeviceProxy::TouchDown, i, mx, my);
                     mCurrentApplication->touchDown(i, mx, my);
                 }
                 break;
@@ -254,6 +258,7 @@ int System::Internal::AndroidApplication::handleInput(AInputEvent *event)
                 {
                     int mx = AMotionEvent_getX(event, i);
                     int my = AMotionEvent_getY(event, i);
+                    deviceProxy->dispatchTouch(System::Internal::DeviceProxy::TouchUp, i, mx, my);
                     mCurrentApplication->touchUp(i, mx, my);
                 }
                 break;
@@ -262,6 +267,7 @@ int System::Internal::AndroidApplication::handleInput(AInputEvent *event)
                 {
                     int mx = AMotionEvent_getX(event, i);
                     int my = AMotionEvent_getY(event, i);
+                    deviceProxy->dispatchTouch(System::Internal::DeviceProxy::TouchMove, i, mx, my);
                     mCurrentApplication->touchMove(i, mx, my);
                 }
                 break;
@@ -270,6 +276,7 @@ int System::Internal::AndroidApplication::handleInput(AInputEvent *event)
                 {
                     int mx = AMotionEvent_getX(event, i);
                     int my = AMotionEvent_getY(event, i);
+                    deviceProxy->dispatchTouch(System::Internal::DeviceProxy::TouchCancel, i, mx, my);
                     mCurrentApplication->touchCancel(i, mx, my);
                 }
                 break;
@@ -348,6 +355,29 @@ void System::Internal::AndroidApplication::mainLoop(void)
     mCurrentApplication = application.get();
     mCurrentApplicationState = Initialization;
 
+    // input recording and replay, selected with
+    // adb shell setprop debug.simpledual.record (or .replay) <file>
+    char recordName[PROP_VALUE_MAX];
+    char replayName[PROP_VALUE_MAX];
+
+    System::InputRecorder recorder;
+    if (__system_property_get("debug.simpledual.record", recordName) > 0 && !recorder.start(recordName))
+    {
+        LOG_DEBUG( LOG_SYS, "cannot record input to %s", recordName);
+    }
+
+    // the driver references the application, it is released with it
+    std::unique_ptr<System::ReplayDriver> replay;
+    if (__system_property_get("debug.simpledual.replay", replayName) > 0)
+    {
+        replay.reset(new System::ReplayDriver(application));
+        mReplayingInput = replay->open(replayName);
+        if (!mReplayingInput)
+        {
+            LOG_DEBUG( LOG_SYS, "cannot replay input from %s", replayName);
+        }
+    }
+
     while (nv_app_status_running(mNativeAppInstance))
     {
         // Read all pending events.
@@ -426,18 +456,33 @@ void System::Internal::AndroidApplication::mainLoop(void)
 
                 case MainLoop:
                 {
-                    // handle keyboard events
-                    double frameTime = deviceProxy->getTime();
-                    deviceProxy->updateKeyboardState(frameTime);
-
-                    if (mCurrentApplication->update())
+                    if (mReplayingInput)
                     {
-                        mCurrentApplicationState = PrepareForExit;
-                        break;
+                        // the record replaces the platform input
+                        if (!replay->step())
+                        {
+                            mCurrentApplicationState = PrepareForExit;
+                            break;
+                        }
                     }
+                    else
+                    {
+                        // handle keyboard events
+                        double frameTime = deviceProxy->getTime();
+                        deviceProxy->updateKeyboardState(frameTime);
+
+                        if (mCurrentApplication->update())
+                        {
+                            mCurrentApplicationState = PrepareForExit;
+                            break;
+                        }
+                    }
+                    deviceProxy->markFrameUpdated();
 
+                    double const inputTag = deviceProxy->beginFrameDraw();
                     mCurrentApplication->draw();
                     mEgl->swap();
+                    deviceProxy->markFramePresented(inputTag);
                     break;
                 }
 
@@ -455,6 +500,21 @@ void System::Internal::AndroidApplication::mainLoop(void)
             // we have to make sure to clean up while we still have EGL context current
             if (mCurrentApplication != 0)
             {
+                deviceProxy->getInputLatencyHistogram().log("input-to-present latency (ms)");
+
+                if (recorder.isRecording())
+                {
+                    recorder.stop();
+                    LOG_DEBUG( LOG_SYS, "recorded %u frames of input to %s", recorder.getFrameCount(), recordName);
+                }
+
+                if (mReplayingInput)
+                {
+                    mReplayingInput = false;
+                    replay->getFrameTimeHistogram().log("replay frame time (ms)");
+                }
+                replay.reset();
+
                 application->exit();
                 // dereference application instance
                 mCurrentApplication = 0;
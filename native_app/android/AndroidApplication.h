@@ -64,6 +64,7 @@ private:
 
     System::Key mButtonMapping[MaximumKeyCodeValue];
     int mPreviousDigitalCrossState;
+    bool mReplayingInput;
 };
 
 }
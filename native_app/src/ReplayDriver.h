@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef REPLAYDRIVER_H_
+#define REPLAYDRIVER_H_
+
+/**
+ * @file
+ * Definition of ReplayDriver.
+ */
+
+#include "Application.h"
+#include "DeviceProxy.h"
+#include "Histogram.h"
+#include "InputRecord.h"
+
+// smallest bucket of the replay frame time histogram, in milliseconds
+#define REPLAY_FRAME_TIME_UNIT 0.25
+
+namespace System
+{
+
+/**
+ * Drives an application with a record written by InputRecorder instead of
+ * the platform input, one recorded frame per step(). The recorded events
+ * reach the application callbacks and DeviceProxy in their recorded order
+ * and frames, so two builds replaying the same record do the same work and
+ * their frame time histograms can be compared. Recorded times are shifted
+ * to the current clock, relative times and input latency are preserved.
+ */
+class ReplayDriver
+{
+public:
+    ReplayDriver(managed_ptr<Application> const &app)
+            : mApp(app), mFrameTimes(REPLAY_FRAME_TIME_UNIT), mTimeOffset(0.0), mLastStepTime(-1.0),
+              mFrameCount(0), mStarted(false)
+    {
+    }
+
+    ~ReplayDriver(void)
+    {
+    }
+
+    /**
+     * Opens a record for replay.
+     * @param name - name of the file
+     * @return false if the record cannot be read
+     */
+    bool open(char const *name)
+    {
+        mStarted = false;
+        mLastStepTime = -1.0;
+        mFrameCount = 0;
+        mFrameTimes.reset();
+
+        return mReader.open(name);
+    }
+
+    /**
+     * Replays the next recorded frame: dispatches its input events, updates
+     * the keyboard state and calls Application::update(). Called in place
+     * of the platform input handling, once per frame. Like the platform
+     * loops, the application callbacks of an event are called in the frame
+     * that applies it, before updateKeyboardState().
+     * @return false at the end of the record or if the application exits
+     */
+    bool step(void)
+    {
+        Internal::DeviceProxy *proxy = Internal::DeviceProxy::GetInstance();
+        double const now = proxy->getTime();
+
+        InputRecordEntry entry;
+        while (mReader.read(entry))
+        {
+            if (!mStarted)
+            {
+                mTimeOffset = now - entry.time;
+                mStarted = true;
+            }
+
+            if (entry.isFrame)
+            {
+                if (mLastStepTime >= 0.0)
+                {
+                    mFrameTimes.add(now - mLastStepTime);
+                }
+                mLastStepTime = now;
+                mFrameCount++;
+
+                proxy->updateKeyboardState(entry.time + mTimeOffset);
+                return !mApp->update();
+            }
+
+            entry.event.time += mTimeOffset;
+            proxy->dispatchInputEvent(entry.event);
+            dispatchToApplication(entry.event);
+        }
+
+        mReader.close();
+        return false;
+    }
+
+    /**
+     * Returns the distribution of the time between step() calls, in
+     * milliseconds.
+     */
+    Histogram const &getFrameTimeHistogram(void) const
+    {
+        return mFrameTimes;
+    }
+
+    uint getFrameCount(void) const
+    {
+        return mFrameCount;
+    }
+
+private:
+    // prevent copy construction and assignment
+    ReplayDriver(ReplayDriver const &instance);
+    ReplayDriver &operator=(ReplayDriver const &instance);
+
+    void dispatchToApplication(Internal::DeviceProxy::InputEventData const &event)
+    {
+        switch (event.type)
+        {
+        case Internal::DeviceProxy::InputKeyDown:
+            mApp->keyDown(event.key);
+            break;
+
+        case Internal::DeviceProxy::InputKeyUp:
+            mApp->keyUp(event.key);
+            break;
+
+        case Internal::DeviceProxy::InputTouch:
+            switch (event.touch.action)
+            {
+            case Internal::DeviceProxy::TouchDown:
+                mApp->touchDown(event.touch.id, event.touch.x, event.touch.y);
+                break;
+            case Internal::DeviceProxy::TouchMove:
+                mApp->touchMove(event.touch.id, event.touch.x, event.touch.y);
+                break;
+            case Internal::DeviceProxy::TouchUp:
+                mApp->touchUp(event.touch.id, event.touch.x, event.touch.y);
+                break;
+            case Internal::DeviceProxy::TouchCancel:
+                mApp->touchCancel(event.touch.id, event.touch.x, event.touch.y);
+                break;
+            }
+            break;
+
+        case Internal::DeviceProxy::InputAnalogAxis:
+            // applications read analog axes from DeviceProxy only
+            break;
+        }
+    }
+
+    managed_ptr<Application> mApp;
+    InputRecordReader mReader;
+    Histogram mFrameTimes;
+    double mTimeOffset;
+    double mLastStepTime;
+    uint mFrameCount;
+    bool mStarted;
+};
+
+}
+
+#endif /* REPLAYDRIVER_H_ */
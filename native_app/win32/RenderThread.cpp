@@ -12,6 +12,7 @@
 #include <GL/wglew.h>
 #include "RenderThread.h"
 #include "Device.h"
+#include "DeviceProxy.h"
 #include "SystemCore.h"
 
 System::RenderThread::RenderThread(HDC windowDC, managed_ptr<Application> const &app)
@@ -150,18 +151,24 @@ void System::RenderThread::run(void)
     mFrameTimer.setFPS(Device::CanvasMaxFPS);
     mFrameTimer.start();
 
+    System::Internal::DeviceProxy *dproxy = System::Internal::DeviceProxy::GetInstance();
+
     // main render loop
     while (mIsRunning)
     {
         mFrameTimer.waitForTick();
+        double const inputTag = dproxy->beginFrameDraw();
         mApplication->draw();
 
         SwapBuffers(mWindowDrawContext);
+        dproxy->markFramePresented(inputTag);
     }
 
     // stop render timer thread
     mFrameTimer.stop();
 
+    dproxy->getInputLatencyHistogram().log("input-to-present latency (ms)");
+
     // notify the application about termination
     mApplication->exit();
 }
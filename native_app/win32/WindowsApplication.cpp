@@ -8,11 +8,14 @@
  * license agreement from NVIDIA Corporation is strictly prohibited.
  */
 
+#include <string.h>
 #include <memory>
 #include "WindowsApplication.h"
 #include "Device.h"
 #include "RenderThread.h"
 #include "DeviceProxy.h"
+#include "InputRecord.h"
+#include "ReplayDriver.h"
 
 // XXX: this constant might be missing in MinGW Win32 SDK
 #ifndef MAPVK_VK_TO_CHAR
@@ -24,7 +27,7 @@ static LPCWSTR gAppWindowTitle = L"NVIDIA Test Framework";
 
 System::Internal::WindowsApplication::WindowsApplication(void)
         : mInstanceHandle(0), mWindowHandle(0), mWindowDCHandle(0), mShowMouseCursor(false), mMouseX(0), mMouseY(0),
-          mMouseKeys(0), mKeyLastPressedCode(0), mDebugLogLevel(LOG_ALL)
+          mMouseKeys(0), mKeyLastPressedCode(0), mReplayingInput(false), mDebugLogLevel(LOG_ALL)
 {
     initKeyboard();
 }
@@ -162,7 +165,7 @@ LRESULT System::Internal::WindowsApplication::eventHandler(HWND hWnd, UINT messa
             int scanCode = HIWORD(lParam) & 0xff;
             System::Key key = scanCode < SC_TOTAL_COUNT ? mScanCodeDecodeTable[scanCode] : KeyNone;
 
-            if (key != KeyNone)
+            if (key != KeyNone && !mReplayingInput)
             {
                 System::Internal::DeviceProxy::GetInstance()->dispatchKeyDown(key);
                 mCurrentApplication->keyDown(key);
@@ -176,7 +179,7 @@ LRESULT System::Internal::WindowsApplication::eventHandler(HWND hWnd, UINT messa
         int scanCode = HIWORD(lParam) & 0xff;
         System::Key key = scanCode < SC_TOTAL_COUNT ? mScanCodeDecodeTable[scanCode] : KeyNone;
 
-        if (key != KeyNone)
+        if (key != KeyNone && !mReplayingInput)
         {
             System::Internal::DeviceProxy::GetInstance()->dispatchKeyUp(key);
             mCurrentApplication->keyUp(key);
@@ -327,7 +330,8 @@ static bool ProcessWindowMessageQueue(void)
     return true;
 }
 
-void System::Internal::WindowsApplication::runApplication(managed_ptr<System::Application> const &app)
+void System::Internal::WindowsApplication::runApplication(managed_ptr<System::Application> const &app,
+                                                          char const *recordName, char const *replayName)
 {
     mCurrentApplication = app;
 
@@ -339,6 +343,23 @@ void System::Internal::WindowsApplication::runApplication(managed_ptr<System::Ap
     managed_ptr<System::RenderThread> renderThread = new System::RenderThread(mWindowDCHandle, app);
     renderThread->start();
 
+    // input recording and replay
+    System::InputRecorder recorder;
+    if (recordName != 0 && !recorder.start(recordName))
+    {
+        LOG_DEBUG(LOG_SYS, "cannot record input to %s", recordName);
+    }
+
+    System::ReplayDriver replay(app);
+    if (replayName != 0)
+    {
+        mReplayingInput = replay.open(replayName);
+        if (!mReplayingInput)
+        {
+            LOG_DEBUG(LOG_SYS, "cannot replay input from %s", replayName);
+        }
+    }
+
     int prevMouseX = mMouseX;
     int prevMouseY = mMouseY;
     int prevMouseKeys = mMouseKeys;
@@ -351,6 +372,42 @@ void System::Internal::WindowsApplication::runApplication(managed_ptr<System::Ap
             break;
         }
 
+        if (mReplayingInput)
+        {
+            // the record replaces the mouse and keyboard
+            if (!replay.step())
+            {
+                break;
+            }
+            dproxy->markFrameUpdated();
+            continue;
+        }
+
+        // handle mouse events before the input is applied, so that touches
+        // reach the application and DeviceProxy in the same frame as keys
+        int eventFlag = prevMouseKeys ^ mMouseKeys;
+        if (eventFlag & 0x1)
+        {
+            if (mMouseKeys & 0x1)
+            {
+                dproxy->dispatchTouch(System::Internal::DeviceProxy::TouchDown, 0, mMouseX, mMouseY);
+                app->touchDown(0, mMouseX, mMouseY);
+            }
+            else
+            {
+                dproxy->dispatchTouch(System::Internal::DeviceProxy::TouchUp, 0, mMouseX, mMouseY);
+                app->touchUp(0, mMouseX, mMouseY);
+            }
+        }
+        else
+        {
+            if ((mMouseKeys & 0x1) != 0 && (mMouseX != prevMouseX || mMouseY != prevMouseY))
+            {
+                dproxy->dispatchTouch(System::Internal::DeviceProxy::TouchMove, 0, mMouseX, mMouseY);
+                app->touchMove(0, mMouseX, mMouseY);
+            }
+        }
+
         // handle keyboard events
         double frameTime = dproxy->getTime();
         dproxy->updateKeyboardState(frameTime);
@@ -380,33 +437,13 @@ void System::Internal::WindowsApplication::runApplication(managed_ptr<System::Ap
             renderThread->setFPS(Device::CanvasMaxFPS >> 2);
         }
 
-        // handle mouse events
-        int eventFlag = prevMouseKeys ^ mMouseKeys;
-        if (eventFlag & 0x1)
-        {
-            if (mMouseKeys & 0x1)
-            {
-                app->touchDown(0, mMouseX, mMouseY);
-            }
-            else
-            {
-                app->touchUp(0, mMouseX, mMouseY);
-            }
-        }
-        else
-        {
-            if ((mMouseKeys & 0x1) != 0 && (mMouseX != prevMouseX || mMouseY != prevMouseY))
-            {
-                app->touchMove(0, mMouseX, mMouseY);
-            }
-        }
-
         // execute app loop code
         if (app->update())
         {
             // exit program
             break;
         }
+        dproxy->markFrameUpdated();
 
         // clean-up and update mouse & keyboard events
         mKeyLastPressedCode = 0;
@@ -417,12 +454,39 @@ void System::Internal::WindowsApplication::runApplication(managed_ptr<System::Ap
         prevMouseKeys = mMouseKeys;
     }
 
+    if (recorder.isRecording())
+    {
+        recorder.stop();
+        LOG_DEBUG(LOG_SYS, "recorded %u frames of input to %s", recorder.getFrameCount(), recordName);
+    }
+
+    if (mReplayingInput)
+    {
+        mReplayingInput = false;
+        replay.getFrameTimeHistogram().log("replay frame time (ms)");
+    }
+
     // dereference
     mCurrentApplication.reset();
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    // -record <file> records the input, -replay <file> replays a record
+    char const *recordName = 0;
+    char const *replayName = 0;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "-record") == 0)
+        {
+            recordName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-replay") == 0)
+        {
+            replayName = argv[++i];
+        }
+    }
+
     // init native application
     managed_ptr<System::Internal::WindowsApplication> nativeApp(new System::Internal::WindowsApplication());
 
@@ -440,7 +504,7 @@ int main(void)
         return 0;
     }
 
-    nativeApp->runApplication(app);
+    nativeApp->runApplication(app, recordName, replayName);
 
     // dereference app
     app = 0;
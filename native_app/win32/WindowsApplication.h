@@ -33,7 +33,14 @@ public:
 
     bool openWindow(HINSTANCE hinst, int width, int height, bool showCursor);
     void closeWindow(void);
-    void runApplication(managed_ptr<System::Application> const &app);
+
+    /**
+     * Runs the application till it exits or the window is closed.
+     * @param app - application to run
+     * @param recordName - optional, file to record the input to
+     * @param replayName - optional, input record that replaces the mouse and keyboard
+     */
+    void runApplication(managed_ptr<System::Application> const &app, char const *recordName, char const *replayName);
 
 private:
     static LRESULT WINAPI EventHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
@@ -50,6 +57,7 @@ private:
     bool mShowMouseCursor;
     int mMouseX, mMouseY, mMouseKeys;
     int mKeyLastPressedCode;
+    bool mReplayingInput;
 
     // debug log level mask
     int mDebugLogLevel;
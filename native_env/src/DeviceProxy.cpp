@@ -22,6 +22,9 @@
 #define SK_SET(ptr,i)   ((ptr)[(i)>>5]|=1<<((i)&0x1f))
 #define SK_RESET(ptr,i) ((ptr)[(i)>>5]&=~(1<<((i)&0x1f)))
 
+// mPendingInputTime value when all updated input has been drawn
+#define NO_PENDING_INPUT (~static_cast<uint64>(0))
+
 static std::vector<managed_ptr<ManagedAbstractObject> > gDeviceProxyComponents(
         System::Internal::DeviceProxy::TotalComponentCount);
 
@@ -54,8 +57,9 @@ System::Internal::DeviceProxy *System::Internal::DeviceProxy::GetInstance(void)
  * @return true if initialization was a success, false otherwise
  */
 System::Internal::DeviceProxy::DeviceProxy()
-        : mTimer(), mLastKeyEventTime(0), mInterruptTime(0), mInterruptShift(0), mKeyLastPressedChar(0),
-          mExternalPath(), mScreenWidth(0), mScreenHeight(0)
+        : mTimer(), mAppliedInputTime(-1.0), mPendingInputTime(NO_PENDING_INPUT), mInputLatency(DEVICE_PROXY_LATENCY_UNIT),
+          mLastKeyEventTime(0), mInterruptTime(0), mInterruptShift(0), mKeyLastPressedChar(0), mExternalPath(),
+          mScreenWidth(0), mScreenHeight(0)
 {
     // user input support
     int tsize = sizeof(uint) * (System::TotalKeyCodeCount >> 5);
@@ -79,6 +83,11 @@ System::Internal::DeviceProxy::DeviceProxy()
 
 System::Internal::DeviceProxy::~DeviceProxy()
 {
+    InputEvent *event;
+    while ((event = mInputEvents.pop()) != 0)
+    {
+        mInputEventAllocator.deallocate(event);
+    }
 }
 
 uint System::Internal::DeviceProxy::getScreenPixelWidth(void)
@@ -108,11 +117,76 @@ void System::Internal::DeviceProxy::updateKeyboardState(double time)
 {
     mLastKeyEventTime = time;
 
-    for (int i = 0; i < (System::TotalKeyCodeCount >> 5); i++)
+    int const tsize = sizeof(uint) * (System::TotalKeyCodeCount >> 5);
+    System::MemorySet(mKeyPressed, 0, tsize);
+    System::MemorySet(mKeyReleased, 0, tsize);
+
+    // events are applied one by one, so a key tapped between two frames
+    // is both pressed and released in this one
+    InputEvent *event;
+    double oldestEventTime = -1.0;
+    while ((event = mInputEvents.pop()) != 0)
+    {
+        if (oldestEventTime < 0.0)
+        {
+            oldestEventTime = event->time;
+        }
+
+        applyInputEvent(*event);
+        mInputEventAllocator.deallocate(event);
+    }
+
+    if (oldestEventTime >= 0.0 && mAppliedInputTime < 0.0)
     {
-        mKeyPressed[i] = mKeyState[i] & (mKeyState[i] ^ mKeyPrevState[i]);
-        mKeyReleased[i] = mKeyPrevState[i] & (mKeyPrevState[i] ^ mKeyState[i]);
-        mKeyPrevState[i] = mKeyState[i];
+        mAppliedInputTime = oldestEventTime;
+    }
+
+    System::MemoryCopy(mKeyPrevState, mKeyState, tsize);
+
+    mFrameSignal(time);
+}
+
+System::Internal::DeviceProxy::InputEvent *System::Internal::DeviceProxy::createInputEvent(InputEventType type)
+{
+    InputEvent *event = mInputEventAllocator.allocate();
+    event->type = type;
+    event->time = mTimer.get();
+    return event;
+}
+
+void System::Internal::DeviceProxy::applyInputEvent(InputEvent const &event)
+{
+    mInputEventSignal(event);
+
+    switch (event.type)
+    {
+    case InputKeyDown:
+        if (!SK_ISSET(mKeyState, event.key))
+        {
+            SK_SET(mKeyState, event.key);
+            SK_SET(mKeyPressed, event.key);
+            mKeyPressTime[event.key] = event.time;
+            mKeyLastRepeatTime[event.key] = 0;
+        }
+        mKeyDownSignal(event.key);
+        break;
+
+    case InputKeyUp:
+        if (SK_ISSET(mKeyState, event.key))
+        {
+            SK_RESET(mKeyState, event.key);
+            SK_SET(mKeyReleased, event.key);
+        }
+        mKeyUpSignal(event.key);
+        break;
+
+    case InputTouch:
+        mTouchSignal(event.touch.action, event.touch.id, event.touch.x, event.touch.y);
+        break;
+
+    case InputAnalogAxis:
+        mAnalogAxisValue[event.axis.id] = event.axis.value;
+        break;
     }
 }
 
@@ -195,19 +269,107 @@ void System::Internal::DeviceProxy::keyReset(System::Key key)
     SK_RESET(mKeyReleased, key);
 }
 
+/**
+ * Queues a key down event, applied by the next updateKeyboardState().
+ * Callable from any thread.
+ * @param key - key code
+ */
 void System::Internal::DeviceProxy::dispatchKeyDown(System::Key key)
 {
-    if (!SK_ISSET(mKeyState, key))
+    InputEvent *event = createInputEvent(InputKeyDown);
+    event->key = key;
+    mInputEvents.push(event);
+}
+
+void System::Internal::DeviceProxy::dispatchKeyUp(System::Key key)
+{
+    InputEvent *event = createInputEvent(InputKeyUp);
+    event->key = key;
+    mInputEvents.push(event);
+}
+
+void System::Internal::DeviceProxy::dispatchTouch(TouchAction action, int id, int x, int y)
+{
+    InputEvent *event = createInputEvent(InputTouch);
+    event->touch.action = action;
+    event->touch.id = id;
+    event->touch.x = x;
+    event->touch.y = y;
+    mInputEvents.push(event);
+}
+
+/**
+ * Queues a copy of an event, e.g. one read from an input record. The
+ * timestamp of the event is kept.
+ * @param data - event to queue
+ */
+void System::Internal::DeviceProxy::dispatchInputEvent(InputEventData const &data)
+{
+    InputEvent *event = mInputEventAllocator.allocate();
+    static_cast<InputEventData &>(*event) = data;
+    mInputEvents.push(event);
+}
+
+System::Internal::DeviceProxy::InputEventSignal &System::Internal::DeviceProxy::getInputEventSignal(void)
+{
+    return mInputEventSignal;
+}
+
+System::Internal::DeviceProxy::KeySignal &System::Internal::DeviceProxy::getKeyDownSignal(void)
+{
+    return mKeyDownSignal;
+}
+
+System::Internal::DeviceProxy::KeySignal &System::Internal::DeviceProxy::getKeyUpSignal(void)
+{
+    return mKeyUpSignal;
+}
+
+System::Internal::DeviceProxy::TouchSignal &System::Internal::DeviceProxy::getTouchSignal(void)
+{
+    return mTouchSignal;
+}
+
+System::Internal::DeviceProxy::FrameSignal &System::Internal::DeviceProxy::getFrameSignal(void)
+{
+    return mFrameSignal;
+}
+
+void System::Internal::DeviceProxy::markFrameUpdated(void)
+{
+    if (mAppliedInputTime < 0.0)
+    {
+        return;
+    }
+
+    // keep the older input if no frame has been drawn since
+    uint64 const inputTime = static_cast<uint64>(mAppliedInputTime * 1000.0);
+    uint64 pending = mPendingInputTime.load(std::memory_order_relaxed);
+    while (inputTime < pending
+            && !mPendingInputTime.compare_exchange_weak(pending, inputTime, std::memory_order_relaxed))
     {
-        SK_SET(mKeyState, key);
-        mKeyPressTime[key] = mLastKeyEventTime;
-        mKeyLastRepeatTime[key] = 0;
     }
+
+    mAppliedInputTime = -1.0;
 }
 
-void System::Internal::DeviceProxy::dispatchKeyUp(System::Key key)
+double System::Internal::DeviceProxy::beginFrameDraw(void)
 {
-    SK_RESET(mKeyState, key);
+    uint64 const inputTime = mPendingInputTime.exchange(NO_PENDING_INPUT, std::memory_order_relaxed);
+    return inputTime != NO_PENDING_INPUT ? inputTime * 0.001 : -1.0;
+}
+
+void System::Internal::DeviceProxy::markFramePresented(double inputTag)
+{
+    if (inputTag >= 0.0)
+    {
+        mInputLatency.add(mTimer.get() - inputTag);
+    }
+}
+
+System::Histogram &System::Internal::DeviceProxy::getInputLatencyHistogram(void)
+{
+    return mInputLatency;
 }
 
 float System::Internal::DeviceProxy::getAnalogAxis(AnalogAxis id)
@@ -217,7 +379,10 @@ float System::Internal::DeviceProxy::getAnalogAxis(AnalogAxis id)
 
 void System::Internal::DeviceProxy::setAnalogAxis(AnalogAxis id, float value)
 {
-    mAnalogAxisValue[id] = value;
+    InputEvent *event = createInputEvent(InputAnalogAxis);
+    event->axis.id = id;
+    event->axis.value = value;
+    mInputEvents.push(event);
 }
 
 double System::Internal::DeviceProxy::getTime(void)
@@ -238,6 +403,9 @@ std::string const &System::Internal::DeviceProxy::getExternalPath(void)
 void System::Internal::DeviceProxy::setExternalPath(std::string const &path)
 {
     mExternalPath = path;
+
+    // cached file locations depend on the external path
+    GetComponents()[ComponentFilePathIndex].reset();
 }
 
 #ifdef ANDROID
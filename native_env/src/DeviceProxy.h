@@ -13,7 +13,12 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 #include "ManagedPtr.h"
+#include "ConcurrentBlockAllocator.h"
+#include "MPSCQueue.h"
+#include "Signal.h"
+#include "Histogram.h"
 #include "System.h"
 #include "SystemTimer.h"
 
@@ -28,6 +33,11 @@ namespace System
 namespace Internal
 {
 
+// maximal number of subscribers of each input and frame signal
+#define DEVICE_PROXY_SIGNAL_CAPACITY 8
+// smallest bucket of the input latency histogram, in milliseconds
+#define DEVICE_PROXY_LATENCY_UNIT 0.25
+
 // internal system object
 
 class DeviceProxy: public ManagedAbstractObject
@@ -35,7 +45,11 @@ class DeviceProxy: public ManagedAbstractObject
 public:
     enum Components
     {
-        ComponentProxyInstance = 0, ComponentCamera, ComponentFileCacheBlockAllocator, TotalComponentCount
+        ComponentProxyInstance = 0,
+        ComponentCamera,
+        ComponentFileCacheBlockAllocator,
+        ComponentFilePathIndex,
+        TotalComponentCount
     };
 
     enum AnalogAxis
@@ -49,6 +63,65 @@ public:
         TotalAnalogAxisCount
     };
 
+    enum TouchAction
+    {
+        TouchDown = 0,
+        TouchMove,
+        TouchUp,
+        TouchCancel
+    };
+
+    enum InputEventType
+    {
+        InputKeyDown = 0,
+        InputKeyUp,
+        InputTouch,
+        InputAnalogAxis
+    };
+
+    /**
+     * Input event dispatched to the proxy, copyable for recording.
+     */
+    struct InputEventData
+    {
+        InputEventType type;
+        double time; // getTime() when the event was dispatched
+        union
+        {
+            System::Key key;
+            struct
+            {
+                TouchAction action;
+                int id;
+                int x;
+                int y;
+            } touch;
+            struct
+            {
+                AnalogAxis id;
+                float value;
+            } axis;
+        };
+    };
+
+    /**
+     * Input event queued by the dispatch functions and applied by
+     * updateKeyboardState().
+     */
+    struct InputEvent: public NVR::MPSCQueueNode<InputEvent>, public InputEventData
+    {
+    };
+
+    // every applied input event, including analog axis changes
+    typedef NVR::Signal<DEVICE_PROXY_SIGNAL_CAPACITY, InputEventData const &> InputEventSignal;
+
+    // key code
+    typedef NVR::Signal<DEVICE_PROXY_SIGNAL_CAPACITY, System::Key> KeySignal;
+    // action, pointer id, x and y coordinate
+    typedef NVR::Signal<DEVICE_PROXY_SIGNAL_CAPACITY, TouchAction, int, int, int> TouchSignal;
+    // frame time in milliseconds
+    typedef NVR::Signal<DEVICE_PROXY_SIGNAL_CAPACITY, double> FrameSignal;
+
     DeviceProxy(void);
     ~DeviceProxy(void);
 
@@ -57,6 +130,12 @@ public:
     uint getScreenPixelHeight(void);
     void setScreenPixelHeight(uint value);
 
+    /**
+     * Applies the input events dispatched since the last call, in order,
+     * and starts a new input frame. Key signals and the touch signal are
+     * emitted here, on the thread calling it.
+     * @param time - frame time
+     */
     void updateKeyboardState(double time);
     bool keyIsPressed(System::Key key, int delay);
     bool keyIsPressed(System::Key key);
@@ -68,6 +147,49 @@ public:
 
     void dispatchKeyDown(System::Key key);
     void dispatchKeyUp(System::Key key);
+    void dispatchTouch(TouchAction action, int id, int x, int y);
+    void dispatchInputEvent(InputEventData const &data);
+
+    /**
+     * Signals emitted by updateKeyboardState() for the events dispatched
+     * since the previous frame, followed by the frame signal. Subscribers
+     * are called directly, subscribe during initialization.
+     */
+    InputEventSignal &getInputEventSignal(void);
+    KeySignal &getKeyDownSignal(void);
+    KeySignal &getKeyUpSignal(void);
+    TouchSignal &getTouchSignal(void);
+    FrameSignal &getFrameSignal(void);
+
+    /**
+     * Hands the input applied by updateKeyboardState() over to the next
+     * frame drawn, to be called on the same thread after Application::update()
+     * has processed it.
+     */
+    void markFrameUpdated(void);
+
+    /**
+     * Takes the input handed over by markFrameUpdated() for the frame about
+     * to be drawn, to be called right before Application::draw(). Input
+     * handed over while the frame is drawn goes to the next one.
+     * @return input tag of the frame, pass it to markFramePresented()
+     */
+    double beginFrameDraw(void);
+
+    /**
+     * Records the input latency of a frame, to be called right after the
+     * frame was presented (SwapBuffers(), eglSwapBuffers()). The latency is
+     * the time from the oldest input event the frame reflects to the present
+     * call. Frames without input are not recorded.
+     * @param inputTag - value returned by beginFrameDraw() for this frame
+     */
+    void markFramePresented(double inputTag);
+
+    /**
+     * Gets the input-to-present latency histogram in milliseconds. It is
+     * updated by markFramePresented(), read it on that thread.
+     */
+    Histogram &getInputLatencyHistogram(void);
 
     float getAnalogAxis(AnalogAxis id);
     void setAnalogAxis(AnalogAxis id, float value);
@@ -93,8 +215,22 @@ public:
     static DeviceProxy *GetInstance(void);
 
 private:
+    InputEvent *createInputEvent(InputEventType type);
+    void applyInputEvent(InputEvent const &event);
+
     Timer mTimer;
 
+    // events dispatched by the input threads, drained once per frame
+    ConcurrentTypedBlockAllocator<InputEvent> mInputEventAllocator;
+    NVR::MPSCQueue<InputEvent> mInputEvents;
+
+    // time of the oldest input applied but not yet updated, negative if none
+    double mAppliedInputTime;
+    // timestamp of the oldest updated input not yet drawn, in microseconds,
+    // all ones if none; set by markFrameUpdated(), taken by beginFrameDraw()
+    std::atomic<uint64> mPendingInputTime;
+    Histogram mInputLatency;
+
     double mLastKeyEventTime;
     double mInterruptTime;
     double mInterruptShift;
@@ -107,6 +243,12 @@ private:
 
     float mAnalogAxisValue[TotalAnalogAxisCount];
 
+    InputEventSignal mInputEventSignal;
+    KeySignal mKeyDownSignal;
+    KeySignal mKeyUpSignal;
+    TouchSignal mTouchSignal;
+    FrameSignal mFrameSignal;
+
     std::string mExternalPath;
     uint mScreenWidth;
     uint mScreenHeight;
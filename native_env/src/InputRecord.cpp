@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include "SystemCore.h"
+#include "InputRecord.h"
+
+// file identification, "NVIR" and format version
+#define INPUT_RECORD_MAGIC      0x5249564e
+#define INPUT_RECORD_VERSION    1
+
+namespace
+{
+
+typedef System::Internal::DeviceProxy DeviceProxy;
+
+// on-disk layout, stored in host byte order
+typedef struct InputRecordHeaderStruct
+{
+    uint magic;
+    uint version;
+    uint entrySize;
+    uint reserved;
+} InputRecordHeader;
+
+enum InputRecordEntryType
+{
+    InputRecordFrame = 0,
+    InputRecordKeyDown,
+    InputRecordKeyUp,
+    InputRecordTouch,
+    InputRecordAnalogAxis
+};
+
+typedef struct InputRecordDiskEntryStruct
+{
+    uint type;
+    int values[5];
+    double time;
+} InputRecordDiskEntry;
+
+static_assert(sizeof(InputRecordDiskEntry) == 32, "input record entries must stay 32 bytes");
+
+void EncodeInputEvent(DeviceProxy::InputEventData const &event, InputRecordDiskEntry &entry)
+{
+    System::MemorySet(&entry, 0, sizeof(entry));
+    entry.time = event.time;
+
+    switch (event.type)
+    {
+    case DeviceProxy::InputKeyDown:
+    case DeviceProxy::InputKeyUp:
+        entry.type = event.type == DeviceProxy::InputKeyDown ? InputRecordKeyDown : InputRecordKeyUp;
+        entry.values[0] = event.key;
+        break;
+
+    case DeviceProxy::InputTouch:
+        entry.type = InputRecordTouch;
+        entry.values[0] = event.touch.action;
+        entry.values[1] = event.touch.id;
+        entry.values[2] = event.touch.x;
+        entry.values[3] = event.touch.y;
+        break;
+
+    case DeviceProxy::InputAnalogAxis:
+        entry.type = InputRecordAnalogAxis;
+        entry.values[0] = event.axis.id;
+        System::MemoryCopy(&entry.values[1], &event.axis.value, sizeof(float));
+        break;
+    }
+}
+
+bool DecodeInputEvent(InputRecordDiskEntry const &entry, DeviceProxy::InputEventData &event)
+{
+    event.time = entry.time;
+
+    switch (entry.type)
+    {
+    case InputRecordKeyDown:
+    case InputRecordKeyUp:
+        event.type = entry.type == InputRecordKeyDown ? DeviceProxy::InputKeyDown : DeviceProxy::InputKeyUp;
+        event.key = static_cast<System::Key>(entry.values[0]);
+        return true;
+
+    case InputRecordTouch:
+        event.type = DeviceProxy::InputTouch;
+        event.touch.action = static_cast<DeviceProxy::TouchAction>(entry.values[0]);
+        event.touch.id = entry.values[1];
+        event.touch.x = entry.values[2];
+        event.touch.y = entry.values[3];
+        return true;
+
+    case InputRecordAnalogAxis:
+        event.type = DeviceProxy::InputAnalogAxis;
+        event.axis.id = static_cast<DeviceProxy::AnalogAxis>(entry.values[0]);
+        System::MemoryCopy(&event.axis.value, &entry.values[1], sizeof(float));
+        return true;
+    }
+
+    return false;
+}
+
+}
+
+// ==========================================================================
+// RECORDER
+// ==========================================================================
+
+System::InputRecorder::InputRecorder(void)
+        : mFile(), mFrameCount(0)
+{
+}
+
+System::InputRecorder::~InputRecorder(void)
+{
+    stop();
+}
+
+bool System::InputRecorder::start(char const *name)
+{
+    stop();
+
+    DeviceProxy *proxy = DeviceProxy::GetInstance();
+    DeviceProxy::InputEventSignal::Slot const eventSlot =
+            DeviceProxy::InputEventSignal::Slot::CreateFromMethod<InputRecorder, &InputRecorder::onInputEvent>(this);
+    DeviceProxy::FrameSignal::Slot const frameSlot =
+            DeviceProxy::FrameSignal::Slot::CreateFromMethod<InputRecorder, &InputRecorder::onFrame>(this);
+
+    managed_ptr<File> file(new File());
+    if (!file->open(name, File::FileWrite))
+    {
+        LOG_DEBUG(LOG_SYS, "cannot open input record %s", name);
+        return false;
+    }
+
+    if (!proxy->getInputEventSignal().connect(eventSlot))
+    {
+        return false;
+    }
+    if (!proxy->getFrameSignal().connect(frameSlot))
+    {
+        proxy->getInputEventSignal().disconnect(eventSlot);
+        return false;
+    }
+
+    InputRecordHeader header;
+    header.magic = INPUT_RECORD_MAGIC;
+    header.version = INPUT_RECORD_VERSION;
+    header.entrySize = sizeof(InputRecordDiskEntry);
+    header.reserved = 0;
+    file->writeBytes(&header, sizeof(header));
+
+    mFile = file;
+    mFrameCount = 0;
+
+    return true;
+}
+
+void System::InputRecorder::stop(void)
+{
+    if (mFile.get() == 0)
+    {
+        return;
+    }
+
+    DeviceProxy *proxy = DeviceProxy::GetInstance();
+    proxy->getInputEventSignal().disconnect(
+            DeviceProxy::InputEventSignal::Slot::CreateFromMethod<InputRecorder, &InputRecorder::onInputEvent>(this));
+    proxy->getFrameSignal().disconnect(
+            DeviceProxy::FrameSignal::Slot::CreateFromMethod<InputRecorder, &InputRecorder::onFrame>(this));
+
+    mFile->close();
+    mFile.reset();
+}
+
+void System::InputRecorder::onInputEvent(Internal::DeviceProxy::InputEventData const &event)
+{
+    InputRecordDiskEntry entry;
+    EncodeInputEvent(event, entry);
+    mFile->writeBytes(&entry, sizeof(entry));
+}
+
+void System::InputRecorder::onFrame(double time)
+{
+    InputRecordDiskEntry entry;
+    System::MemorySet(&entry, 0, sizeof(entry));
+    entry.type = InputRecordFrame;
+    entry.time = time;
+    mFile->writeBytes(&entry, sizeof(entry));
+
+    mFrameCount++;
+}
+
+// ==========================================================================
+// READER
+// ==========================================================================
+
+System::InputRecordReader::InputRecordReader(void)
+        : mFile()
+{
+}
+
+System::InputRecordReader::~InputRecordReader(void)
+{
+    close();
+}
+
+bool System::InputRecordReader::open(char const *name)
+{
+    close();
+
+    managed_ptr<File> file(new File());
+    if (!file->open(name, File::FileRead))
+    {
+        LOG_DEBUG(LOG_SYS, "cannot open input record %s", name);
+        return false;
+    }
+
+    InputRecordHeader header;
+    if (file->readBytes(&header, sizeof(header)) != sizeof(header) || header.magic != INPUT_RECORD_MAGIC
+            || header.version != INPUT_RECORD_VERSION || header.entrySize != sizeof(InputRecordDiskEntry))
+    {
+        LOG_DEBUG(LOG_SYS, "%s is not an input record", name);
+        return false;
+    }
+
+    mFile = file;
+
+    return true;
+}
+
+void System::InputRecordReader::close(void)
+{
+    if (mFile.get() != 0)
+    {
+        mFile->close();
+        mFile.reset();
+    }
+}
+
+bool System::InputRecordReader::read(InputRecordEntry &entry)
+{
+    if (mFile.get() == 0)
+    {
+        return false;
+    }
+
+    InputRecordDiskEntry diskEntry;
+    while (mFile->readBytes(&diskEntry, sizeof(diskEntry)) == sizeof(diskEntry))
+    {
+        entry.time = diskEntry.time;
+        if (diskEntry.type == InputRecordFrame)
+        {
+            entry.isFrame = true;
+            return true;
+        }
+
+        // entries of unknown type are skipped
+        if (DecodeInputEvent(diskEntry, entry.event))
+        {
+            entry.isFrame = false;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef INPUTRECORD_H_
+#define INPUTRECORD_H_
+
+/**
+ * @file
+ * Recording of DeviceProxy input and frame timing, see InputRecorder and
+ * InputRecordReader. A record is a sequence of the input events applied
+ * by DeviceProxy::updateKeyboardState(), each frame closed by a frame
+ * entry, all with their original timestamps.
+ */
+
+#include "Base.h"
+#include "ManagedPtr.h"
+#include "SystemFile.h"
+#include "DeviceProxy.h"
+
+namespace System
+{
+
+/**
+ * Entry of an input record.
+ */
+struct InputRecordEntry
+{
+    bool isFrame;
+    double time; // frame time of frame entries
+    Internal::DeviceProxy::InputEventData event; // valid if not isFrame
+};
+
+/**
+ * Writes the input applied by DeviceProxy to a file while recording. It
+ * subscribes to the input event and frame signals of the proxy, so it
+ * runs on the frame thread and adds no work to the input threads.
+ */
+class InputRecorder
+{
+public:
+    InputRecorder(void);
+    ~InputRecorder(void);
+
+    /**
+     * Starts recording.
+     * @param name - name of the file, relative to the external path
+     * @return false if the file could not be opened or the signals are full
+     */
+    bool start(char const *name);
+
+    /**
+     * Stops recording and closes the file.
+     */
+    void stop(void);
+
+    bool isRecording(void) const
+    {
+        return mFile.get() != 0;
+    }
+
+    uint getFrameCount(void) const
+    {
+        return mFrameCount;
+    }
+
+private:
+    // prevent copy construction and assignment
+    InputRecorder(InputRecorder const &instance);
+    InputRecorder &operator=(InputRecorder const &instance);
+
+    void onInputEvent(Internal::DeviceProxy::InputEventData const &event);
+    void onFrame(double time);
+
+    managed_ptr<File> mFile;
+    uint mFrameCount;
+};
+
+/**
+ * Reads a record written by InputRecorder.
+ */
+class InputRecordReader
+{
+public:
+    InputRecordReader(void);
+    ~InputRecordReader(void);
+
+    /**
+     * Opens a record.
+     * @param name - name of the file
+     * @return false if the file could not be opened or is not a record
+     */
+    bool open(char const *name);
+
+    void close(void);
+
+    /**
+     * Reads the next entry.
+     * @param entry - receives the entry
+     * @return false at the end of the record
+     */
+    bool read(InputRecordEntry &entry);
+
+private:
+    // prevent copy construction and assignment
+    InputRecordReader(InputRecordReader const &instance);
+    InputRecordReader &operator=(InputRecordReader const &instance);
+
+    managed_ptr<File> mFile;
+};
+
+}
+
+#endif /* INPUTRECORD_H_ */
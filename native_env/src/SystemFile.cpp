@@ -16,6 +16,7 @@
 #include "SystemFile.h"
 #include "DeviceProxy.h"
 #include "MemAlloc.h"
+#include "StringIndex.h"
 
 #define STD_FILE(x) (static_cast<FILE *>(x))
 #define AAF_FILE(x) (static_cast<AAsset *>(x))
@@ -61,6 +62,30 @@ void System::File::reset(void)
     mNativeAccessMode = SystemFileAccess;
 }
 
+// places a file can be read from, in search order
+enum FileLocation
+{
+    UnknownFileLocation = 0, AssetFileLocation, ExternalFileLocation, PlainFileLocation, TotalFileLocationCount
+};
+
+// file name -> location it was last opened from for reading
+typedef System::StringIndex<int> FilePathIndex;
+
+static FilePathIndex *GetFilePathIndex(void)
+{
+    std::vector<managed_ptr<ManagedAbstractObject> > &components(System::Internal::DeviceProxy::GetComponents());
+
+    FilePathIndex *instance =
+            static_cast<FilePathIndex *>(components[System::Internal::DeviceProxy::ComponentFilePathIndex].get());
+    if (instance == 0)
+    {
+        instance = new FilePathIndex();
+        components[System::Internal::DeviceProxy::ComponentFilePathIndex] = instance;
+    }
+
+    return instance;
+}
+
 #ifdef ANDROID
 static char const *SkipPrefix(char const *str, char const *prefix)
 {
@@ -79,58 +104,118 @@ static char const *SkipPrefix(char const *str, char const *prefix)
 }
 #endif
 
-/**
- * Checks whether a file exists in native file system.
- * @param name - file name
- * @return true if file exists, false otherwise
- */
-bool System::File::Exists(const char *name)
+static void *OpenAtLocation(char const *name, int location)
 {
-    bool fileExists = false;
     void *nativeFile = 0;
 
-#ifdef ANDROID
-    // try to open as an asset in the .apk
-    AAssetManager *am = Internal::DeviceProxy::GetInstance()->getNativeAssetManager();
-    if (am != 0)
+    switch (location)
     {
-        nativeFile = AAssetManager_open(am, SkipPrefix(name, "assets/"), AASSET_MODE_UNKNOWN);
+#ifdef ANDROID
+        case AssetFileLocation:
+        {
+            AAssetManager *am = System::Internal::DeviceProxy::GetInstance()->getNativeAssetManager();
+            if (am != 0)
+            {
+                nativeFile = AAssetManager_open(am, SkipPrefix(name, "assets/"), AASSET_MODE_UNKNOWN);
+            }
+            break;
+        }
+#endif
+#if defined(_WIN32) || defined(LINUX) || defined(ANDROID) || (defined(__APPLE__) && defined(__MACH__))
+        case ExternalFileLocation:
+        {
+            std::string fileName(System::Internal::DeviceProxy::GetInstance()->getExternalPath());
+            fileName += name;
+            nativeFile = fopen(fileName.c_str(), "rb");
+            break;
+        }
+        case PlainFileLocation:
+            nativeFile = fopen(name, "rb");
+            break;
+#endif
+        default:
+            break;
     }
 
-    if (nativeFile != 0)
+    return nativeFile;
+}
+
+static void CloseAtLocation(void *nativeFile, int location)
+{
+#ifdef ANDROID
+    if (location == AssetFileLocation)
     {
-        fileExists = true;
         AAsset_close(AAF_FILE(nativeFile));
+        return;
     }
-    else
-    {
 #endif
-    // fread
+    (void)location;
 #if defined(_WIN32) || defined(LINUX) || defined(ANDROID) || (defined(__APPLE__) && defined(__MACH__))
-    std::string fileName(Internal::DeviceProxy::GetInstance()->getExternalPath());
-    fileName += name;
-    nativeFile = fopen(fileName.c_str(), "rb");
+    fclose(STD_FILE(nativeFile));
+#endif
+}
 
-    if (nativeFile != 0)
-    {
-        fileExists = true;
-        fclose(STD_FILE(nativeFile));
-    }
-    else
+/**
+ * Opens a file for reading. The locations are searched in the usual order:
+ * .apk assets, external path, plain name. The .apk assets do not change
+ * while running, so a name found elsewhere before skips them on the next
+ * open, and repeated opens of an asset or an external file cost one open
+ * call instead of up to three. Files can appear under the external path at
+ * any time, so it is still searched before the plain name.
+ * @param name - file name
+ * @param location - receives the location the file was opened from,
+ *                   UnknownFileLocation if it was not found
+ * @return native file handle or null
+ */
+static void *OpenForReading(char const *name, int &location)
+{
+    location = UnknownFileLocation;
+
+    FilePathIndex *index = GetFilePathIndex();
+    FilePathIndex::Entry *entry = index->find(name);
+    int const cachedLocation = entry != 0 ? entry->value() : UnknownFileLocation;
+    int const firstLocation = cachedLocation > AssetFileLocation ? ExternalFileLocation : AssetFileLocation;
+
+    for (int i = firstLocation; i < TotalFileLocationCount; i++)
     {
-        nativeFile = fopen(name, "rb");
+        void *nativeFile = OpenAtLocation(name, i);
         if (nativeFile != 0)
         {
-            fileExists = true;
-            fclose(STD_FILE(nativeFile));
+            // only names that exist are interned
+            if (entry == 0)
+            {
+                entry = index->intern(name);
+            }
+            entry->value() = i;
+            location = i;
+            return nativeFile;
         }
     }
-#endif
-#ifdef ANDROID
+
+    if (entry != 0)
+    {
+        entry->value() = UnknownFileLocation;
+    }
+
+    return 0;
 }
-#endif
 
-    return fileExists;
+/**
+ * Checks whether a file exists in native file system.
+ * @param name - file name
+ * @return true if file exists, false otherwise
+ */
+bool System::File::Exists(const char *name)
+{
+    int location;
+    void *nativeFile = OpenForReading(name, location);
+    if (nativeFile == 0)
+    {
+        return false;
+    }
+
+    CloseAtLocation(nativeFile, location);
+    return true;
 }
 
 /**
@@ -158,37 +243,19 @@ bool System::File::open(const char *name, OpenMode mode)
         fileName += name;
         nativeFile = fopen(fileName.c_str(), "wb");
 #endif
-    }
-    else
-    {
-#ifdef ANDROID
-        // try to open as an asset in the .apk
-        nativeAccessMode = VirtualFileAccess;
-        AAssetManager *am = Internal::DeviceProxy::GetInstance()->getNativeAssetManager();
-        if (am != 0)
-        {
-            nativeFile = AAssetManager_open(am, SkipPrefix(name, "assets/"), AASSET_MODE_UNKNOWN);
-        }
 
-        if (!nativeFile)
+        // the file may now shadow the location cached for reading
+        FilePathIndex::Entry *entry = GetFilePathIndex()->find(name);
+        if (entry != 0)
         {
-#endif
-        // fread
-        nativeAccessMode = SystemFileAccess;
-#if defined(_WIN32) || defined(LINUX) || defined(ANDROID) || (defined(__APPLE__) && defined(__MACH__))
-        std::string fileName(Internal::DeviceProxy::GetInstance()->getExternalPath());
-        fileName += name;
-        nativeFile = fopen(fileName.c_str(), "rb");
-
-        if (!nativeFile)
-        {
-            nativeFile = fopen(name, "rb");
+            entry->value() = UnknownFileLocation;
         }
-#endif
-
-#ifdef ANDROID
     }
-#endif
+    else
+    {
+        int location;
+        nativeFile = OpenForReading(name, location);
+        nativeAccessMode = location == AssetFileLocation ? VirtualFileAccess : SystemFileAccess;
     }
 
     if (!nativeFile)
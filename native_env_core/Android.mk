@@ -5,6 +5,10 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := native_env_core
 
 LOCAL_CFLAGS := -Wall -Wcast-align -Wextra -std=gnu++0x -DARCH_ARM -DDEBUG_MODE
+# serve System::MemoryAlloc() from the size-class allocator instead of malloc
+#LOCAL_CFLAGS += -DMEMORY_SIZE_CLASS_ALLOCATOR
+# track allocations by memory category and call site
+#LOCAL_CFLAGS += -DMEMORY_TRACKING
 
 ifeq ($(NDK_DEBUG),1)
   LOCAL_CFLAGS += -DDEBUG
@@ -12,6 +12,7 @@
 #define ALIGNEDSTLALLOCATOR_H_
 
 #include <memory>
+#include <utility>
 #include "SystemCore.h"
 
 namespace NVR {
@@ -56,14 +57,14 @@ public:
         System::MemoryFree(ptr);
     }
 
-    void construct(pointer ptr, const_reference instance) const
+    template<typename U, typename ... Args> void construct(U *ptr, Args &&... args) const
     {
-        new (static_cast<void *>(ptr)) value_type(instance);
+        new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
     }
 
-    void destroy(const_pointer ptr) const
+    template<typename U> void destroy(U *ptr) const
     {
-        ptr->~value_type();
+        ptr->~U();
     }
 
     // The following must be the same for all allocators.
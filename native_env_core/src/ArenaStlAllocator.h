@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef ARENASTLALLOCATOR_H_
+#define ARENASTLALLOCATOR_H_
+
+#include <memory>
+#include "SystemCore.h"
+#include "LinearArena.h"
+
+namespace NVR {
+
+/**
+ * STL allocator drawing from a LinearArena, e.g. the current arena of a
+ * FrameArena. deallocate() does nothing, the memory is released by the
+ * arena reset, so a container must not be used after its arena has been
+ * reset. Growing containers leave their old buffers behind until the
+ * reset, reserve() them when the size is known.
+ */
+template<typename T> class ArenaStlAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef T const * const_pointer;
+    typedef T& reference;
+    typedef T const & const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    ArenaStlAllocator(System::LinearArena &arena)
+            : mArena(&arena)
+    {
+    }
+
+    template<typename U> ArenaStlAllocator(ArenaStlAllocator<U> const &other)
+            : mArena(other.getArena())
+    {
+    }
+
+    pointer address(reference instance) const
+    {
+        return &instance;
+    }
+
+    const_pointer address(const_reference instance) const
+    {
+        return &instance;
+    }
+
+    size_type max_size(void) const
+    {
+        return (static_cast<size_type>(0) - static_cast<size_type>(1)) / sizeof(T);
+    }
+
+    pointer allocate(size_type n, void *hint = 0) const
+    {
+        (void)hint;
+        return mArena->allocateArray<T>(n, CACHELINE_ALIGNMENT);
+    }
+
+    void deallocate(pointer ptr, size_type n) const
+    {
+        (void)ptr;
+        (void)n;
+    }
+
+    void construct(pointer ptr, const_reference instance) const
+    {
+        new (static_cast<void *>(ptr)) value_type(instance);
+    }
+
+    void destroy(const_pointer ptr) const
+    {
+        ptr->~value_type();
+    }
+
+    System::LinearArena *getArena(void) const
+    {
+        return mArena;
+    }
+
+    // The following must be the same for all allocators.
+    template<typename U>
+    struct rebind
+    {
+        typedef ArenaStlAllocator<U> other;
+    };
+
+private:
+    System::LinearArena *mArena;
+};
+
+template<typename T, typename U> inline bool operator==(ArenaStlAllocator<T> const &a, ArenaStlAllocator<U> const &b)
+{
+    return a.getArena() == b.getArena();
+}
+
+template<typename T, typename U> inline bool operator!=(ArenaStlAllocator<T> const &a, ArenaStlAllocator<U> const &b)
+{
+    return a.getArena() != b.getArena();
+}
+
+}
+
+#endif /* ARENASTLALLOCATOR_H_ */
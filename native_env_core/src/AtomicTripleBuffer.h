@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _ATOMICTRIPLEBUFFER_H
+#define _ATOMICTRIPLEBUFFER_H
+
+/**
+ * @file
+ *
+ * Definition of AtomicTripleBuffer
+ */
+
+#include <pthread.h>
+#include <atomic>
+#include "Base.h"
+
+namespace System
+{
+
+/**
+ * Lock-free drop-in replacement for TripleBuffer. The buffer indices of the
+ * front, back and spare slots, the origin of the spare buffer (which doubles
+ * as the fresh-data flag) and the finalized flag are packed into a single
+ * atomic word, so swaps and reads are one compare-and-swap or one load.
+ * The mutex is only touched by blocking trySwapAndGet*() calls that have
+ * to wait, and by swaps that need to wake such a waiter.
+ */
+template<class T> class AtomicTripleBuffer
+{
+public:
+    /**
+     * Default constructor.
+     */
+    template<typename U> AtomicTripleBuffer(U const &front, U const &back, U const &spare)
+            : mFrontBuffer(front), mBackBuffer(back), mSpareBuffer(spare),
+              mState(InitialState), mWaiterCount(0)
+    {
+        init();
+    }
+
+    /**
+     * Constructs all three buffers with the default constructor of T. Meant
+     * for buffers filled in place through getWritableBackBuffer().
+     */
+    AtomicTripleBuffer(void)
+            : mFrontBuffer(), mBackBuffer(), mSpareBuffer(), mState(InitialState), mWaiterCount(0)
+    {
+        init();
+    }
+
+    /**
+     * Default destructor.
+     */
+    ~AtomicTripleBuffer(void)
+    {
+        finalize();
+
+        // XXX: dirty hack, see ~TripleBuffer()
+        pthread_mutex_lock(&mSwapWaitLock);
+        pthread_mutex_unlock(&mSwapWaitLock);
+
+        pthread_mutex_destroy(&mSwapWaitLock);
+        pthread_cond_destroy(&mSwapSignal);
+    }
+
+    /*
+     * Cancel all pending consume requests and stop swapping.
+     */
+    void finalize()
+    {
+        if (isFinalized())
+        {
+            return;
+        }
+
+        mState.fetch_or(FinalizedBit);
+
+        pthread_mutex_lock(&mSwapWaitLock);
+        pthread_cond_broadcast(&mSwapSignal);
+        pthread_mutex_unlock(&mSwapWaitLock);
+    }
+
+    /**
+     * Returns true if buffer is finalized, false otherwise
+     */
+    bool isFinalized(void)
+    {
+        return (mState.load(std::memory_order_acquire) & FinalizedBit) != 0;
+    }
+
+    /**
+     * Swaps front buffer with an empty buffer.
+     * @return pointer to the active front buffer
+     */
+    T const &swapFrontBuffer(void)
+    {
+        return swapBuffer(0);
+    }
+
+    /**
+     * Gets a pointer to active front buffer. The pointer is valid
+     * till next call to swapFrontBuffer().
+     * @return pointer to the front buffer
+     */
+    T const &getFrontBuffer(void)
+    {
+        return getBuffer(0);
+    }
+
+    T const &trySwapAndGetFrontBuffer(bool blocking, bool *swapSuccessful = 0)
+    {
+        T *rbuffer;
+
+        bool swapResult = trySwapAndGetBuffer(0, blocking, &rbuffer);
+        if (swapSuccessful != 0)
+        {
+            *swapSuccessful = swapResult;
+        }
+
+        return *rbuffer;
+    }
+
+    /**
+     * Swaps back buffer with an empty buffer.
+     * @return pointer to the active back buffer
+     */
+    T const &swapBackBuffer(void)
+    {
+        return swapBuffer(1);
+    }
+
+    /**
+     * Gets a pointer to active back buffer. The pointer is valid
+     * till next call to swapBackBuffer().
+     * @return pointer to the back buffer
+     */
+    T const &getBackBuffer(void)
+    {
+        return getBuffer(1);
+    }
+
+    T const &trySwapAndGetBackBuffer(bool blocking, bool *swapSuccessful = 0)
+    {
+        T *rbuffer;
+
+        bool swapResult = trySwapAndGetBuffer(1, blocking, &rbuffer);
+        if (swapSuccessful != 0)
+        {
+            *swapSuccessful = swapResult;
+        }
+
+        return *rbuffer;
+    }
+
+    /**
+     * Gets the back buffer for writing in place. Only the producer may call
+     * it; the reference is valid till the next publishBackBuffer() call.
+     * @return writable back buffer
+     */
+    T &getWritableBackBuffer(void)
+    {
+        return getBuffer(1);
+    }
+
+    /**
+     * Publishes the filled back buffer (same as swapBackBuffer()) and hands
+     * the producer the next buffer to fill.
+     * @return writable back buffer
+     */
+    T &publishBackBuffer(void)
+    {
+        return swapBuffer(1);
+    }
+
+    /**
+     * Publishes the filled back buffer only if the consumer has picked up the
+     * previously published one, see trySwapAndGetBackBuffer().
+     * @return writable back buffer
+     */
+    T &tryPublishBackBuffer(bool blocking, bool *swapSuccessful = 0)
+    {
+        T *rbuffer;
+
+        bool swapResult = trySwapAndGetBuffer(1, blocking, &rbuffer);
+        if (swapSuccessful != 0)
+        {
+            *swapSuccessful = swapResult;
+        }
+
+        return *rbuffer;
+    }
+
+private:
+    AtomicTripleBuffer(AtomicTripleBuffer const &);
+    AtomicTripleBuffer &operator=(AtomicTripleBuffer const &);
+
+    void init(void)
+    {
+        pthread_mutex_init(&mSwapWaitLock, 0);
+        pthread_cond_init(&mSwapSignal, 0);
+
+        mBufferPtr[0] = &mFrontBuffer;
+        mBufferPtr[1] = &mBackBuffer;
+        mBufferPtr[2] = &mSpareBuffer;
+    }
+
+    // state word layout: 2 bits of buffer index per slot (front, back, spare),
+    // 2 bits of spare buffer origin (0 - front, 1 - back, 2 - none) and the finalized flag
+    enum
+    {
+        SlotBits = 2,
+        SlotMask = 0x3,
+        OriginShift = 6,
+        OriginNone = 2,
+        FinalizedBit = 0x100,
+        InitialState = 0 | (1 << SlotBits) | (2 << (2 * SlotBits)) | (OriginNone << OriginShift)
+    };
+
+    FORCE_INLINE static uint GetSlot(uint state, int slot)
+    {
+        return (state >> (slot * SlotBits)) & SlotMask;
+    }
+
+    FORCE_INLINE static uint GetOrigin(uint state)
+    {
+        return (state >> OriginShift) & SlotMask;
+    }
+
+    // exchanges the given slot with the spare slot and marks the spare as coming from it
+    FORCE_INLINE static uint SwapWithSpare(uint state, int slot)
+    {
+        uint const slotBuffer = GetSlot(state, slot);
+        uint const spareBuffer = GetSlot(state, 2);
+        uint const clearMask = (SlotMask << (slot * SlotBits)) | (SlotMask << (2 * SlotBits))
+                               | (SlotMask << OriginShift);
+
+        return (state & ~clearMask) | (spareBuffer << (slot * SlotBits)) | (slotBuffer << (2 * SlotBits))
+               | (slot << OriginShift);
+    }
+
+    T &getBuffer(int bufferIndex)
+    {
+        return *mBufferPtr[GetSlot(mState.load(std::memory_order_acquire), bufferIndex)];
+    }
+
+    bool trySwapAndGetBuffer(int bufferIndex, bool blocking, T **rbuffer)
+    {
+        uint state = mState.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            if ((state & FinalizedBit) != 0)
+            {
+                *rbuffer = mBufferPtr[GetSlot(state, bufferIndex)];
+                return false;
+            }
+
+            if (GetOrigin(state) == static_cast<uint>(1 - bufferIndex))
+            {
+                uint const newState = SwapWithSpare(state, bufferIndex);
+                if (mState.compare_exchange_weak(state, newState))
+                {
+                    notifyWaiters();
+
+                    *rbuffer = mBufferPtr[GetSlot(newState, bufferIndex)];
+                    return true;
+                }
+
+                // lost the race, state has been reloaded
+                continue;
+            }
+
+            if (!blocking)
+            {
+                *rbuffer = mBufferPtr[GetSlot(state, bufferIndex)];
+                return false;
+            }
+
+            // slow path: sleep till the other side swaps
+            state = waitForStateChange(state);
+        }
+    }
+
+    T &swapBuffer(int bufferIndex)
+    {
+        uint state = mState.load(std::memory_order_acquire);
+        uint newState;
+
+        do
+        {
+            if ((state & FinalizedBit) != 0)
+            {
+                return *mBufferPtr[GetSlot(state, bufferIndex)];
+            }
+
+            newState = SwapWithSpare(state, bufferIndex);
+        }while (!mState.compare_exchange_weak(state, newState));
+
+        notifyWaiters();
+
+        return *mBufferPtr[GetSlot(newState, bufferIndex)];
+    }
+
+    uint waitForStateChange(uint observedState)
+    {
+        pthread_mutex_lock(&mSwapWaitLock);
+
+        // the waiter count has to be published before the state is re-checked,
+        // otherwise a concurrent swap could skip the wake-up
+        mWaiterCount.fetch_add(1);
+
+        uint state = mState.load();
+        while (state == observedState)
+        {
+            pthread_cond_wait(&mSwapSignal, &mSwapWaitLock);
+            state = mState.load();
+        }
+
+        mWaiterCount.fetch_sub(1);
+        pthread_mutex_unlock(&mSwapWaitLock);
+
+        return state;
+    }
+
+    FORCE_INLINE void notifyWaiters(void)
+    {
+        if (mWaiterCount.load() != 0)
+        {
+            pthread_mutex_lock(&mSwapWaitLock);
+            pthread_cond_broadcast(&mSwapSignal);
+            pthread_mutex_unlock(&mSwapWaitLock);
+        }
+    }
+
+    T mFrontBuffer;
+    T mBackBuffer;
+    T mSpareBuffer;
+
+    T *mBufferPtr[3];
+
+    std::atomic<uint> mState;
+    std::atomic<int> mWaiterCount;
+
+    pthread_mutex_t mSwapWaitLock;
+    pthread_cond_t mSwapSignal;
+};
+
+}
+
+#endif
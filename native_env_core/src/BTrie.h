@@ -16,16 +16,38 @@
 namespace NVR
 {
 
+// undefined for zero
+FORCE_INLINE int CountLeadingZeros(uint value)
+{
+    return __builtin_clz(value);
+}
+
+FORCE_INLINE int CountLeadingZeros(uint64 value)
+{
+    return __builtin_clzll(value);
+}
+
+/**
+ * Trie node type that splits keys into buckets by the position of the most
+ * significant set bit, which keeps the tries of small keys shallow. The
+ * key type can be uint or uint64.
+ *
+ * Node types used with BTrie have to provide KeyType, NodePtr, key(),
+ * child(), KeyBucketCount, GetKeyBucketIndex() and GetBucketRootMask().
+ * Buckets with a lower index must hold larger keys, and the root mask of a
+ * bucket selects the bit that splits the children of the bucket root.
+ */
 template<typename T, typename K> class BTrieNode
 {
+    static_assert(sizeof(K) == sizeof(uint) || sizeof(K) == sizeof(uint64), "BTrieNode needs 32 or 64-bit keys");
+
 public:
     typedef K KeyType;
     typedef T* NodePtr;
 
     enum
     {
-        KeyBucketCount = sizeof(KeyType) * 8,
-        InitialMaskShift = sizeof(KeyType) * 8 - 1
+        KeyBucketCount = sizeof(KeyType) * 8
     };
 
     BTrieNode(void)
@@ -64,7 +86,13 @@ public:
 
     FORCE_INLINE static int GetKeyBucketIndex(KeyType key)
     {
-        return key == 0 ? (KeyBucketCount - 1) : __builtin_clz(key);
+        return key == 0 ? (KeyBucketCount - 1) : CountLeadingZeros(key);
+    }
+
+    // the top bit of the bucket is implied, the children split on the next one
+    FORCE_INLINE static KeyType GetBucketRootMask(int bindex)
+    {
+        return (static_cast<KeyType>(1) << (KeyBucketCount - 1 - bindex)) >> 1;
     }
 
 protected:
@@ -76,29 +104,63 @@ private:
     BTrieNode &operator=(BTrieNode const &);
 };
 
-template<typename T> class BTrieSimpleUIntNode
+/**
+ * BTrieNode aligned to a cache line, so that the key and both child links
+ * (and the start of the payload that follows them) are always fetched with
+ * a single cache line per visited node. Costs padding up to the line size.
+ */
+template<typename T, typename K> class ALIGNED(CACHELINE_ALIGNMENT) BTriePackedNode: public BTrieNode<T, K>
 {
 public:
-    typedef uint KeyType;
+    BTriePackedNode(void)
+    {
+    }
+
+    BTriePackedNode(K key)
+            : BTrieNode<T, K>(key)
+    {
+    }
+};
+
+/**
+ * Shape of a BTrie, see BTrie::getStatistics().
+ */
+struct BTrieStatistics
+{
+    int nodeCount;
+    int leafCount;
+    int usedBucketCount;
+    int maxDepth; // bucket roots have depth 1
+    double averageDepth;
+    double balancedAverageDepth; // average depth of a complete binary tree with the same node count
+};
+
+/**
+ * Trie node type with a single bucket, the children of the root split on
+ * the top bit of the key.
+ */
+template<typename T, typename K> class BTrieSimpleNode
+{
+public:
+    typedef K KeyType;
     typedef T* NodePtr;
 
     enum
     {
-        KeyBucketCount = 1,
-        InitialMaskShift = 31
+        KeyBucketCount = 1
     };
 
-    BTrieSimpleUIntNode(void)
+    BTrieSimpleNode(void)
             : mKey(0)
     {
     }
 
-    BTrieSimpleUIntNode(KeyType key)
+    BTrieSimpleNode(KeyType key)
             : mKey(key)
     {
     }
 
-    ~BTrieSimpleUIntNode(void)
+    ~BTrieSimpleNode(void)
     {
     }
 
@@ -128,15 +190,54 @@ public:
         return 0;
     }
 
+    FORCE_INLINE static KeyType GetBucketRootMask(int bindex)
+    {
+        (void)bindex;
+        return static_cast<KeyType>(1) << (sizeof(KeyType) * 8 - 1);
+    }
+
 protected:
     KeyType mKey;
     NodePtr mChild[2];
 
 private:
-    BTrieSimpleUIntNode(BTrieSimpleUIntNode const &);
-    BTrieSimpleUIntNode &operator=(BTrieSimpleUIntNode const &);
+    BTrieSimpleNode(BTrieSimpleNode const &);
+    BTrieSimpleNode &operator=(BTrieSimpleNode const &);
 };
 
+template<typename T> class BTrieSimpleUIntNode: public BTrieSimpleNode<T, uint>
+{
+public:
+    BTrieSimpleUIntNode(void)
+    {
+    }
+
+    BTrieSimpleUIntNode(uint key)
+            : BTrieSimpleNode<T, uint>(key)
+    {
+    }
+};
+
+template<typename T> class BTrieSimpleUInt64Node: public BTrieSimpleNode<T, uint64>
+{
+public:
+    BTrieSimpleUInt64Node(void)
+    {
+    }
+
+    BTrieSimpleUInt64Node(uint64 key)
+            : BTrieSimpleNode<T, uint64>(key)
+    {
+    }
+};
+
+/**
+ * Intrusive binary trie. Every node holds a key and two children; the
+ * children of a node split on the next lower key bit, so the keys in the
+ * child(0) subtree are smaller than the keys in the child(1) subtree, but
+ * the key of the node itself may be anywhere in the range of its subtree.
+ * Nodes are owned by the caller, the trie never allocates.
+ */
 template<typename T> class BTrie
 {
 public:
@@ -155,7 +256,7 @@ public:
     {
         KeyType nodeKey = node->key();
         int bindex = T::GetKeyBucketIndex(nodeKey);
-        KeyType mask = static_cast<KeyType>(1) << (T::InitialMaskShift - bindex);
+        KeyType mask = T::GetBucketRootMask(bindex);
         NodePtr *currentNodePtr = &mBuckets[bindex];
         NodePtr currentNode = *currentNodePtr;
 
@@ -165,9 +266,9 @@ public:
             {
                 return currentNode;
             }
-            mask >>= 1;
             currentNodePtr = &currentNode->child((nodeKey & mask) != 0);
             currentNode = *currentNodePtr;
+            mask >>= 1;
         }
 
         *currentNodePtr = node;
@@ -180,7 +281,7 @@ public:
     NodePtr remove(KeyType key)
     {
         int bindex = T::GetKeyBucketIndex(key);
-        KeyType mask = static_cast<KeyType>(1) << (T::InitialMaskShift - bindex);
+        KeyType mask = T::GetBucketRootMask(bindex);
         NodePtr *currentNodePtr = &mBuckets[bindex];
         NodePtr currentNode = *currentNodePtr;
 
@@ -190,9 +291,9 @@ public:
             {
                 break;
             }
-            mask >>= 1;
             currentNodePtr = &currentNode->child((key & mask) != 0);
             currentNode = *currentNodePtr;
+            mask >>= 1;
         }
 
         if (currentNode == 0)
@@ -237,7 +338,7 @@ public:
     NodePtr get(KeyType key) const
     {
         int bindex = T::GetKeyBucketIndex(key);
-        KeyType mask = static_cast<KeyType>(1) << (T::InitialMaskShift - bindex);
+        KeyType mask = T::GetBucketRootMask(bindex);
         NodePtr currentNode = mBuckets[bindex];
 
         while (currentNode != 0)
@@ -246,8 +347,8 @@ public:
             {
                 return currentNode;
             }
-            mask >>= 1;
             currentNode = currentNode->child((key & mask) != 0);
+            mask >>= 1;
         }
 
         return 0;
@@ -278,6 +379,21 @@ public:
             }
         }
 
+        return getSubtreeMinimum(currentNode);
+    }
+
+    NodePtr getMaximum(void) const
+    {
+        NodePtr currentNode;
+        for (int i = 0; i < T::KeyBucketCount; i++)
+        {
+            currentNode = mBuckets[i];
+            if (currentNode != 0)
+            {
+                break;
+            }
+        }
+
         if (currentNode == 0)
         {
             return 0;
@@ -285,35 +401,217 @@ public:
 
         KeyType candidateKey = currentNode->key();
         NodePtr candidateNode = currentNode;
-        currentNode = currentNode->child(currentNode->child(0) == 0);
+        currentNode = currentNode->child(currentNode->child(1) != 0);
 
         while (currentNode != 0)
         {
             KeyType currentKey = currentNode->key();
-            if (currentKey < candidateKey)
+            if (currentKey > candidateKey)
             {
                 candidateKey = currentKey;
                 candidateNode = currentNode;
             }
 
-            currentNode = currentNode->child(currentNode->child(0) == 0);
+            currentNode = currentNode->child(currentNode->child(1) != 0);
         }
 
         return candidateNode;
     }
 
-    NodePtr getMaximum(void) const
+    /**
+     * Finds the node with the smallest key not less than the given key.
+     * @param key - lower bound
+     * @return found node or null
+     */
+    NodePtr lowerBound(KeyType key) const
     {
-        NodePtr currentNode;
-        for (int i = 0; i < T::KeyBucketCount; i++)
+        int bindex = T::GetKeyBucketIndex(key);
+        KeyType mask = T::GetBucketRootMask(bindex);
+        NodePtr currentNode = mBuckets[bindex];
+        NodePtr candidateNode = 0;
+        NodePtr skippedSubtree = 0;
+
+        // follow the path of the key; node keys on the path may be anywhere
+        // in their subtree, so each one is a candidate
+        while (currentNode != 0)
         {
-            currentNode = mBuckets[i];
-            if (currentNode != 0)
+            KeyType currentKey = currentNode->key();
+            if (currentKey == key)
+            {
+                return currentNode;
+            }
+            if (currentKey > key && (candidateNode == 0 || currentKey < candidateNode->key()))
+            {
+                candidateNode = currentNode;
+            }
+
+            int const bit = (key & mask) != 0;
+            if (bit == 0 && currentNode->child(1) != 0)
+            {
+                // all keys there are larger, the deepest such subtree holds the smallest ones
+                skippedSubtree = currentNode->child(1);
+            }
+            currentNode = currentNode->child(bit);
+            mask >>= 1;
+        }
+
+        if (skippedSubtree != 0)
+        {
+            NodePtr subtreeMinimum = getSubtreeMinimum(skippedSubtree);
+            if (candidateNode == 0 || subtreeMinimum->key() < candidateNode->key())
+            {
+                candidateNode = subtreeMinimum;
+            }
+        }
+
+        if (candidateNode != 0)
+        {
+            return candidateNode;
+        }
+
+        // buckets with lower index hold larger keys
+        for (int i = bindex - 1; i >= 0; i--)
+        {
+            if (mBuckets[i] != 0)
+            {
+                return getSubtreeMinimum(mBuckets[i]);
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * Finds the node with the smallest key greater than the given key, which
+     * makes it the in-order successor of the node with that key.
+     * @param key - upper bound
+     * @return found node or null
+     */
+    NodePtr upperBound(KeyType key) const
+    {
+        if (key == static_cast<KeyType>(~static_cast<KeyType>(0)))
+        {
+            return 0;
+        }
+
+        return lowerBound(key + 1);
+    }
+
+    /**
+     * Calls the visitor for every node with a key in [first, last], in
+     * ascending key order. Each step is a fresh lowerBound() lookup, so the
+     * visitor may insert or remove nodes, including the visited one.
+     * @param first - smallest key to visit
+     * @param last - largest key to visit
+     * @param visitor - callable invoked with each node
+     */
+    template<typename V> void visitRange(KeyType first, KeyType last, V &visitor) const
+    {
+        NodePtr currentNode = lowerBound(first);
+        while (currentNode != 0)
+        {
+            KeyType currentKey = currentNode->key();
+            if (currentKey > last)
+            {
+                break;
+            }
+
+            visitor(currentNode);
+
+            if (currentKey == last)
             {
                 break;
             }
+            currentNode = lowerBound(currentKey + 1);
+        }
+    }
+
+    /**
+     * Calls the visitor for every node in ascending key order.
+     * @param visitor - callable invoked with each node
+     */
+    template<typename V> void visit(V &visitor) const
+    {
+        visitRange(0, static_cast<KeyType>(~static_cast<KeyType>(0)), visitor);
+    }
+
+    /**
+     * Walks the whole trie and measures its depth, which is what lookups pay
+     * for. The closer averageDepth is to balancedAverageDepth, the better.
+     * @param statistics - receives the result
+     */
+    void getStatistics(BTrieStatistics &statistics) const
+    {
+        // depth is bounded by the key bits, so is the number of pending nodes
+        NodePtr pendingNodes[sizeof(KeyType) * 8 + 4];
+        int pendingDepths[sizeof(KeyType) * 8 + 4];
+        double depthSum = 0.0;
+
+        statistics.nodeCount = 0;
+        statistics.leafCount = 0;
+        statistics.usedBucketCount = 0;
+        statistics.maxDepth = 0;
+
+        for (int i = 0; i < T::KeyBucketCount; i++)
+        {
+            if (mBuckets[i] == 0)
+            {
+                continue;
+            }
+
+            statistics.usedBucketCount++;
+
+            int pendingCount = 1;
+            pendingNodes[0] = mBuckets[i];
+            pendingDepths[0] = 1;
+
+            while (pendingCount > 0)
+            {
+                pendingCount--;
+                NodePtr currentNode = pendingNodes[pendingCount];
+                int const depth = pendingDepths[pendingCount];
+
+                statistics.nodeCount++;
+                depthSum += depth;
+                if (depth > statistics.maxDepth)
+                {
+                    statistics.maxDepth = depth;
+                }
+
+                if (currentNode->child(0) == 0 && currentNode->child(1) == 0)
+                {
+                    statistics.leafCount++;
+                }
+
+                for (int c = 0; c < 2; c++)
+                {
+                    if (currentNode->child(c) != 0)
+                    {
+                        pendingNodes[pendingCount] = currentNode->child(c);
+                        pendingDepths[pendingCount] = depth + 1;
+                        pendingCount++;
+                    }
+                }
+            }
+        }
+
+        statistics.averageDepth = statistics.nodeCount != 0 ? depthSum / statistics.nodeCount : 0.0;
+
+        double balancedDepthSum = 0.0;
+        int remainingCount = statistics.nodeCount;
+        for (int depth = 1, levelSize = 1; remainingCount > 0; depth++, levelSize *= 2)
+        {
+            int const levelCount = remainingCount < levelSize ? remainingCount : levelSize;
+            balancedDepthSum += static_cast<double>(levelCount) * depth;
+            remainingCount -= levelCount;
         }
+        statistics.balancedAverageDepth = statistics.nodeCount != 0 ? balancedDepthSum / statistics.nodeCount : 0.0;
+    }
 
+private:
+    // smallest keys are in child(0) subtrees, but the nodes on the path have to be checked too
+    static NodePtr getSubtreeMinimum(NodePtr currentNode)
+    {
         if (currentNode == 0)
         {
             return 0;
@@ -321,24 +619,23 @@ public:
 
         KeyType candidateKey = currentNode->key();
         NodePtr candidateNode = currentNode;
-        currentNode = currentNode->child(currentNode->child(1) == 0);
+        currentNode = currentNode->child(currentNode->child(0) == 0);
 
         while (currentNode != 0)
         {
             KeyType currentKey = currentNode->key();
-            if (currentKey > candidateKey)
+            if (currentKey < candidateKey)
             {
                 candidateKey = currentKey;
                 candidateNode = currentNode;
             }
 
-            currentNode = currentNode->child(currentNode->child(1) == 0);
+            currentNode = currentNode->child(currentNode->child(0) == 0);
         }
 
         return candidateNode;
     }
 
-private:
     NodePtr mBuckets[T::KeyBucketCount];
 };
 
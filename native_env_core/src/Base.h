@@ -30,6 +30,8 @@ typedef uint8_t uchar;
 #define FORCE_INLINE __attribute__((always_inline)) inline
 #define NO_INLINE __attribute__((noinline))
 #define UNROLL_LOOPS __attribute__((optimize("unroll-loops")))
+#define ALIGNED(x) __attribute__((aligned(x)))
+#define THREAD_LOCAL __thread
 
 #define GCC_VERSION (__GNUC__*10000+__GNUC_MINOR__*100+__GNUC_PATCHLEVEL__)
 /* Test for GCC > 4.7.0 */
@@ -43,6 +45,8 @@ typedef uint8_t uchar;
 #define FORCE_INLINE __forceinline
 #define NO_INLINE __declspec(noinline)
 #define UNROLL_LOOPS
+#define ALIGNED(x) __declspec(align(x))
+#define THREAD_LOCAL __declspec(thread)
 
 #define __builtin_assume_aligned(x,s) (x)
 #undef USE_SSE4
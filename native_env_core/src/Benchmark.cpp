@@ -0,0 +1,726 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "Benchmark.h"
+#include "SystemCore.h"
+#include "SystemTimer.h"
+#include "SystemRandom.h"
+#include "AlignedStlAllocator.h"
+#include "TripleBuffer.h"
+#include "AtomicTripleBuffer.h"
+#include "BTrie.h"
+#include "SizeClassAllocator.h"
+#include "MemoryTracker.h"
+#include "ManagedPtr.h"
+
+#if defined(_MSC_VER)
+#define snprintf _snprintf
+#endif
+
+// keeps the compiler from dropping the measured loops
+static volatile uint g_BenchmarkSink;
+
+static void PrintResult(char const *name, double timeMs, int operationCount)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%-48s %10.3f ms %10.2f ns/op", name, timeMs,
+             operationCount > 0 ? timeMs * 1000000.0 / operationCount : 0.0);
+    System::NativeLog(buffer);
+}
+
+// ==========================================================================
+// TRIPLE BUFFER
+// ==========================================================================
+
+template<typename B> struct SwapThreadData
+{
+    B *buffer;
+    int iterations;
+};
+
+template<typename B> static void *ProducerThreadBody(void *arg)
+{
+    SwapThreadData<B> *data = static_cast<SwapThreadData<B> *>(arg);
+    for (int i = 0; i < data->iterations; i++)
+    {
+        data->buffer->swapBackBuffer();
+    }
+
+    return 0;
+}
+
+template<typename B> static void *ConsumerThreadBody(void *arg)
+{
+    SwapThreadData<B> *data = static_cast<SwapThreadData<B> *>(arg);
+    for (int i = 0; i < data->iterations; i++)
+    {
+        data->buffer->trySwapAndGetFrontBuffer(false);
+    }
+
+    return 0;
+}
+
+template<typename B> static void RunTripleBufferSwap(char const *name, int iterations)
+{
+    char label[128];
+    System::Timer timer;
+
+    // uncontended: a single thread plays both roles
+    {
+        B buffer(0, 1, 2);
+        timer.tic();
+        for (int i = 0; i < iterations; i++)
+        {
+            buffer.swapBackBuffer();
+            buffer.trySwapAndGetFrontBuffer(false);
+        }
+        double const time = timer.toc();
+
+        snprintf(label, sizeof(label), "%s uncontended", name);
+        PrintResult(label, time, iterations * 2);
+    }
+
+    // contended: producer and consumer threads
+    {
+        B buffer(0, 1, 2);
+        SwapThreadData<B> data;
+        data.buffer = &buffer;
+        data.iterations = iterations;
+
+        pthread_t producer, consumer;
+        timer.tic();
+        pthread_create(&producer, 0, &ProducerThreadBody<B>, &data);
+        pthread_create(&consumer, 0, &ConsumerThreadBody<B>, &data);
+        pthread_join(producer, 0);
+        pthread_join(consumer, 0);
+        double const time = timer.toc();
+
+        snprintf(label, sizeof(label), "%s contended", name);
+        PrintResult(label, time, iterations * 2);
+    }
+}
+
+void System::Benchmark::TripleBufferSwap(int iterations)
+{
+    RunTripleBufferSwap<System::TripleBuffer<int> >("TripleBuffer", iterations);
+    RunTripleBufferSwap<System::AtomicTripleBuffer<int> >("AtomicTripleBuffer", iterations);
+}
+
+// ==========================================================================
+// BTRIE
+// ==========================================================================
+
+struct PlainTrieItem: public NVR::BTrieNode<PlainTrieItem, uint>
+{
+    uint payload[4];
+};
+
+struct PackedTrieItem: public NVR::BTriePackedNode<PackedTrieItem, uint>
+{
+    uint payload[4];
+};
+
+enum KeyDistribution
+{
+    DenseKeys, SparseKeys, SequentialKeys
+};
+
+static char const *GetKeyDistributionName(int distribution)
+{
+    switch (distribution)
+    {
+        case DenseKeys:
+            return "dense";
+        case SparseKeys:
+            return "sparse";
+        default:
+            return "sequential";
+    }
+}
+
+static void ShuffleKeys(std::vector<uint> &keys, System::Rand48 &random)
+{
+    for (int i = static_cast<int>(keys.size()) - 1; i > 0; i--)
+    {
+        NVR::xchg(keys[i], keys[static_cast<uint>(random.getInt()) % (i + 1)]);
+    }
+}
+
+static void GenerateKeys(std::vector<uint> &keys, int count, int distribution, System::Rand48 &random)
+{
+    keys.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        switch (distribution)
+        {
+            case DenseKeys:
+                keys[i] = i;
+                break;
+            case SparseKeys:
+                // odd multiplier keeps the keys unique
+                keys[i] = static_cast<uint>(i) * 2654435761u;
+                break;
+            default:
+                // millisecond timestamps of a ~30hz capture
+                keys[i] = 1000000u + static_cast<uint>(i) * 33u + (i % 3);
+                break;
+        }
+    }
+
+    // insert in random order, except for sequential keys which arrive in order
+    if (distribution != SequentialKeys)
+    {
+        ShuffleKeys(keys, random);
+    }
+}
+
+static void PrintTrieStatistics(char const *name, NVR::BTrieStatistics const &statistics)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%-48s depth avg %.2f (balanced %.2f) max %d, %d buckets", name,
+             statistics.averageDepth, statistics.balancedAverageDepth, statistics.maxDepth,
+             statistics.usedBucketCount);
+    System::NativeLog(buffer);
+}
+
+template<typename I> static void RunTrieLookup(char const *name, std::vector<uint> const &keys,
+                                               std::vector<uint> const &lookupKeys, bool printStatistics)
+{
+    char label[128];
+    System::Timer timer;
+    int const count = static_cast<int>(keys.size());
+
+    std::vector<I, NVR::AlignedStlAllocator<I> > items(count);
+    NVR::BTrie<I> trie;
+
+    timer.tic();
+    for (int i = 0; i < count; i++)
+    {
+        items[i].key() = keys[i];
+        items[i].payload[0] = i;
+        trie.insert(&items[i]);
+    }
+    double time = timer.toc();
+    snprintf(label, sizeof(label), "%s insert", name);
+    PrintResult(label, time, count);
+
+    uint checksum = 0;
+    timer.tic();
+    for (int i = 0; i < count; i++)
+    {
+        checksum += trie.get(lookupKeys[i])->payload[0];
+    }
+    time = timer.toc();
+    snprintf(label, sizeof(label), "%s lookup", name);
+    PrintResult(label, time, count);
+
+    g_BenchmarkSink = checksum;
+
+    if (!printStatistics)
+    {
+        return;
+    }
+
+    NVR::BTrieStatistics statistics;
+    trie.getStatistics(statistics);
+    snprintf(label, sizeof(label), "%s shape", name);
+    PrintTrieStatistics(label, statistics);
+
+    // churn: remove and reinsert half of the keys, which exercises the leaf replacement in remove()
+    for (int i = 0; i < count; i += 2)
+    {
+        trie.remove(items[i].key());
+    }
+    for (int i = 0; i < count; i += 2)
+    {
+        trie.insert(&items[i]);
+    }
+
+    trie.getStatistics(statistics);
+    snprintf(label, sizeof(label), "%s shape after churn", name);
+    PrintTrieStatistics(label, statistics);
+}
+
+template<typename M> static void RunMapLookup(char const *name, std::vector<uint> const &keys,
+                                              std::vector<uint> const &lookupKeys)
+{
+    char label[128];
+    System::Timer timer;
+    int const count = static_cast<int>(keys.size());
+
+    std::vector<PlainTrieItem> items(count);
+    M map;
+
+    timer.tic();
+    for (int i = 0; i < count; i++)
+    {
+        items[i].payload[0] = i;
+        map[keys[i]] = &items[i];
+    }
+    double time = timer.toc();
+    snprintf(label, sizeof(label), "%s insert", name);
+    PrintResult(label, time, count);
+
+    uint checksum = 0;
+    timer.tic();
+    for (int i = 0; i < count; i++)
+    {
+        checksum += map.find(lookupKeys[i])->second->payload[0];
+    }
+    time = timer.toc();
+    g_BenchmarkSink = checksum;
+    snprintf(label, sizeof(label), "%s lookup", name);
+    PrintResult(label, time, count);
+}
+
+void System::Benchmark::BTrieLookup(int maxElementCount)
+{
+    // the runs append to the name in their own 128 byte labels
+    char name[64];
+    std::vector<uint> keys;
+    std::vector<uint> lookupKeys;
+    System::Rand48 random(1234);
+
+    for (int distribution = DenseKeys; distribution <= SequentialKeys; distribution++)
+    {
+        for (int count = 1024; count <= maxElementCount; count *= 16)
+        {
+            GenerateKeys(keys, count, distribution, random);
+            lookupKeys = keys;
+            ShuffleKeys(lookupKeys, random);
+
+            char const *distributionName = GetKeyDistributionName(distribution);
+
+            snprintf(name, sizeof(name), "BTrie %s %d", distributionName, count);
+            RunTrieLookup<PlainTrieItem>(name, keys, lookupKeys, true);
+            snprintf(name, sizeof(name), "BTrie packed %s %d", distributionName, count);
+            RunTrieLookup<PackedTrieItem>(name, keys, lookupKeys, false);
+            snprintf(name, sizeof(name), "std::map %s %d", distributionName, count);
+            RunMapLookup<std::map<uint, PlainTrieItem *> >(name, keys, lookupKeys);
+            snprintf(name, sizeof(name), "std::unordered_map %s %d", distributionName, count);
+            RunMapLookup<std::unordered_map<uint, PlainTrieItem *> >(name, keys, lookupKeys);
+        }
+    }
+}
+
+// ==========================================================================
+// MEMORY ALLOCATORS
+// ==========================================================================
+
+// one step of an allocation trace, a zero size releases the slot
+struct AllocTraceOp
+{
+    int slot;
+    uint size;
+    uint alignSize;
+};
+
+static uint GetRandomUInt(System::Rand48 &random, uint range)
+{
+    return static_cast<uint>(random.getInt()) % range;
+}
+
+/**
+ * Generates a trace shaped like one tracking frame: a few hundred short
+ * lived temporaries (feature lists, descriptors, small nodes, now and then
+ * an image) released at the end of the frame, plus long lived map nodes
+ * that are allocated and released slowly.
+ */
+static int GenerateAllocTrace(std::vector<AllocTraceOp> &trace, int frameCount, System::Rand48 &random)
+{
+    int const PersistentSlotCount = 4096;
+    int const TemporaryCountPerFrame = 256;
+
+    std::vector<uint> liveTemporaries;
+    std::vector<bool> livePersistent(PersistentSlotCount, false);
+    AllocTraceOp op;
+
+    trace.clear();
+
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        liveTemporaries.clear();
+
+        for (int i = 0; i < TemporaryCountPerFrame; i++)
+        {
+            uint const kind = GetRandomUInt(random, 100);
+            op.slot = PersistentSlotCount + i;
+            if (kind < 70)
+            {
+                op.size = 16 + GetRandomUInt(random, 240);
+                op.alignSize = 1;
+            }
+            else if (kind < 97)
+            {
+                op.size = 256 + GetRandomUInt(random, 7936);
+                op.alignSize = kind < 85 ? 1 : CACHELINE_ALIGNMENT;
+            }
+            else
+            {
+                op.size = 65536 + GetRandomUInt(random, 640 * 480 * 4);
+                op.alignSize = CACHELINE_ALIGNMENT;
+            }
+            trace.push_back(op);
+            liveTemporaries.push_back(op.slot);
+
+            // map maintenance
+            if ((i & 7) == 0)
+            {
+                op.slot = GetRandomUInt(random, PersistentSlotCount);
+                op.size = livePersistent[op.slot] ? 0 : 32 + (GetRandomUInt(random, 4) << 4);
+                op.alignSize = 1;
+                livePersistent[op.slot] = op.size != 0;
+                trace.push_back(op);
+            }
+        }
+
+        // end of frame, temporaries go in no particular order
+        ShuffleKeys(liveTemporaries, random);
+        for (size_t i = 0; i < liveTemporaries.size(); i++)
+        {
+            op.slot = static_cast<int>(liveTemporaries[i]);
+            op.size = 0;
+            op.alignSize = 1;
+            trace.push_back(op);
+        }
+    }
+
+    for (int i = 0; i < PersistentSlotCount; i++)
+    {
+        if (livePersistent[i])
+        {
+            op.slot = i;
+            op.size = 0;
+            op.alignSize = 1;
+            trace.push_back(op);
+        }
+    }
+
+    return PersistentSlotCount + TemporaryCountPerFrame;
+}
+
+/**
+ * Loads a trace written by StartMemoryTrace(). Block addresses are mapped
+ * to slots, slots of freed blocks are reused. Frees of blocks allocated
+ * before the trace started are dropped, blocks still live at its end are
+ * freed at the end.
+ * @return number of slots used by the trace, -1 if the file is not a trace
+ */
+static int LoadAllocTrace(std::vector<AllocTraceOp> &trace, char const *fileName)
+{
+    FILE *file = fopen(fileName, "rb");
+    if (file == 0)
+    {
+        return -1;
+    }
+
+    System::MemoryTraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MEMORY_TRACE_MAGIC
+            || header.version != MEMORY_TRACE_VERSION)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    std::unordered_map<uint64, int> liveSlots;
+    std::vector<int> freeSlots;
+    int slotCount = 0;
+    System::MemoryTraceRecord record;
+    AllocTraceOp op;
+
+    trace.clear();
+
+    while (fread(&record, sizeof(record), 1, file) == 1)
+    {
+        if (record.size != 0)
+        {
+            if (!freeSlots.empty())
+            {
+                op.slot = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            else
+            {
+                op.slot = slotCount++;
+            }
+            op.size = record.size;
+            op.alignSize = record.alignSize;
+            liveSlots[record.address] = op.slot;
+            trace.push_back(op);
+        }
+        else
+        {
+            std::unordered_map<uint64, int>::iterator it = liveSlots.find(record.address);
+            if (it == liveSlots.end())
+            {
+                continue;
+            }
+
+            op.slot = it->second;
+            op.size = 0;
+            op.alignSize = 1;
+            freeSlots.push_back(op.slot);
+            liveSlots.erase(it);
+            trace.push_back(op);
+        }
+    }
+    fclose(file);
+
+    for (std::unordered_map<uint64, int>::iterator it = liveSlots.begin(); it != liveSlots.end(); ++it)
+    {
+        op.slot = it->second;
+        op.size = 0;
+        op.alignSize = 1;
+        trace.push_back(op);
+    }
+
+    return slotCount;
+}
+
+struct MallocBackend
+{
+    static void *Alloc(size_t size, size_t)
+    {
+        return malloc(size);
+    }
+
+    static void Free(void *ptr)
+    {
+        free(ptr);
+    }
+};
+
+struct HeapMemoryBackend
+{
+    static void *Alloc(size_t size, size_t alignSize)
+    {
+        return System::Internal::HeapMemoryAlloc(size, alignSize);
+    }
+
+    static void Free(void *ptr)
+    {
+        System::Internal::HeapMemoryFree(ptr);
+    }
+};
+
+struct SizeClassBackend
+{
+    static void *Alloc(size_t size, size_t alignSize)
+    {
+        return System::Internal::SizeClassAlloc(size, alignSize);
+    }
+
+    static void Free(void *ptr)
+    {
+        System::Internal::SizeClassFree(ptr);
+    }
+};
+
+struct AllocTraceThreadData
+{
+    std::vector<AllocTraceOp> const *trace;
+    int slotCount;
+    uint checksum; // written by the replaying thread
+};
+
+template<typename B> static void *ReplayAllocTrace(void *arg)
+{
+    AllocTraceThreadData *data = static_cast<AllocTraceThreadData *>(arg);
+    std::vector<AllocTraceOp> const &trace = *data->trace;
+    std::vector<uint *> slots(data->slotCount, static_cast<uint *>(0));
+    uint checksum = 0;
+
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        AllocTraceOp const &op = trace[i];
+        if (op.size != 0)
+        {
+            // touch the block, as its user would
+            uint *ptr = static_cast<uint *>(B::Alloc(op.size, op.alignSize));
+            ptr[0] = op.size;
+            slots[op.slot] = ptr;
+        }
+        else
+        {
+            checksum += slots[op.slot][0];
+            B::Free(slots[op.slot]);
+        }
+    }
+
+    data->checksum = checksum;
+
+    return 0;
+}
+
+template<typename B> static void RunAllocTrace(char const *name, std::vector<AllocTraceOp> const &trace, int slotCount,
+                                               int threadCount)
+{
+    char label[128];
+    System::Timer timer;
+
+    AllocTraceThreadData data;
+    data.trace = &trace;
+    data.slotCount = slotCount;
+    data.checksum = 0;
+
+    // warm up, so that all backends start with their pools populated
+    ReplayAllocTrace<B>(&data);
+
+    timer.tic();
+    ReplayAllocTrace<B>(&data);
+    double time = timer.toc();
+    g_BenchmarkSink = data.checksum;
+    snprintf(label, sizeof(label), "%s 1 thread", name);
+    PrintResult(label, time, static_cast<int>(trace.size()));
+
+    if (threadCount < 2)
+    {
+        return;
+    }
+
+    std::vector<pthread_t> threads(threadCount);
+    std::vector<AllocTraceThreadData> threadData(threadCount, data);
+    timer.tic();
+    for (int i = 0; i < threadCount; i++)
+    {
+        pthread_create(&threads[i], 0, &ReplayAllocTrace<B>, &threadData[i]);
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+    time = timer.toc();
+    for (int i = 0; i < threadCount; i++)
+    {
+        g_BenchmarkSink += threadData[i].checksum;
+    }
+    snprintf(label, sizeof(label), "%s %d threads", name, threadCount);
+    PrintResult(label, time, static_cast<int>(trace.size()) * threadCount);
+}
+
+void System::Benchmark::MemoryAllocTrace(int frameCount, int threadCount, char const *traceFileName)
+{
+    std::vector<AllocTraceOp> trace;
+    int slotCount;
+
+    if (traceFileName != 0)
+    {
+        slotCount = LoadAllocTrace(trace, traceFileName);
+        if (slotCount < 0)
+        {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "cannot read memory trace %s", traceFileName);
+            System::NativeLog(buffer);
+            return;
+        }
+    }
+    else
+    {
+        System::Rand48 random(1234);
+        slotCount = GenerateAllocTrace(trace, frameCount, random);
+    }
+
+    RunAllocTrace<MallocBackend>("malloc (alignment ignored)", trace, slotCount, threadCount);
+    RunAllocTrace<HeapMemoryBackend>("MemoryAlloc heap backend", trace, slotCount, threadCount);
+    RunAllocTrace<SizeClassBackend>("MemoryAlloc size-class backend", trace, slotCount, threadCount);
+}
+
+// ==========================================================================
+// MANAGED POINTER
+// ==========================================================================
+
+struct PlainManagedItem: public ManagedObject<PlainManagedItem>
+{
+    uint payload;
+};
+
+struct AtomicManagedItem: public ManagedObject<AtomicManagedItem, ManagedAtomicRefCountPolicy>
+{
+    uint payload;
+};
+
+template<typename T> struct RefCountThreadData
+{
+    managed_ptr<T> item;
+    int iterations;
+    uint sum; // written by the copying thread
+};
+
+template<typename T> static void *CopyManagedPtr(void *arg)
+{
+    RefCountThreadData<T> *data = static_cast<RefCountThreadData<T> *>(arg);
+    uint sum = 0;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        // copy and release, as when a frame is handed to a task
+        managed_ptr<T> copy(data->item);
+        sum += copy->payload;
+    }
+    data->sum = sum;
+
+    return 0;
+}
+
+template<typename T> static void RunManagedPtrRefCount(char const *name, int iterations, int threadCount)
+{
+    char label[128];
+    System::Timer timer;
+
+    RefCountThreadData<T> data;
+    data.item = managed_ptr<T>(new T());
+    data.item->payload = 1;
+    data.iterations = iterations;
+    data.sum = 0;
+
+    timer.tic();
+    CopyManagedPtr<T>(&data);
+    double time = timer.toc();
+    g_BenchmarkSink = data.sum;
+    snprintf(label, sizeof(label), "%s 1 thread", name);
+    PrintResult(label, time, iterations);
+
+    if (threadCount < 2)
+    {
+        return;
+    }
+
+    // the copies in threadData share the item, as the tasks of a frame would
+    std::vector<pthread_t> threads(threadCount);
+    std::vector<RefCountThreadData<T> > threadData(threadCount, data);
+    timer.tic();
+    for (int i = 0; i < threadCount; i++)
+    {
+        pthread_create(&threads[i], 0, &CopyManagedPtr<T>, &threadData[i]);
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+    time = timer.toc();
+    for (int i = 0; i < threadCount; i++)
+    {
+        g_BenchmarkSink += threadData[i].sum;
+    }
+    snprintf(label, sizeof(label), "%s %d threads", name, threadCount);
+    PrintResult(label, time, iterations * threadCount);
+}
+
+void System::Benchmark::ManagedPtrRefCount(int iterations, int threadCount)
+{
+    // the plain count is only measured on one thread, sharing it would be a race
+    RunManagedPtrRefCount<PlainManagedItem>("managed_ptr plain count", iterations, 1);
+    RunManagedPtrRefCount<AtomicManagedItem>("managed_ptr atomic count", iterations, threadCount);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+/**
+ * @file
+ * Microbenchmarks of the core containers and allocators. Each benchmark
+ * prints its results through System::NativeLog(), so they are available
+ * in release builds as well.
+ */
+
+#include "Base.h"
+
+namespace System
+{
+
+namespace Benchmark
+{
+
+/**
+ * Measures the cost of a swap in TripleBuffer and AtomicTripleBuffer, both
+ * uncontended and with a producer and a consumer thread swapping at full speed.
+ * @param iterations - number of swaps performed by each thread
+ */
+void TripleBufferSwap(int iterations);
+
+/**
+ * Compares BTrie (plain and cache line packed nodes) with std::map and
+ * std::unordered_map on dense, sparse and sequential (timestamp-like) keys,
+ * for sizes growing by 16x up to the given count. Reports insert and lookup
+ * cost and the trie depth before and after remove/insert churn.
+ * @param maxElementCount - largest number of keys tested
+ */
+void BTrieLookup(int maxElementCount);
+
+/**
+ * Replays an allocation trace with malloc, the heap backend of MemoryAlloc()
+ * and the size-class backend. The trace is either recorded from a real run
+ * with StartMemoryTrace() or generated, modelled on a tracking frame
+ * (per-frame temporaries of mixed sizes, slowly changing map nodes,
+ * occasional images).
+ * @param frameCount - number of frames in the generated trace
+ * @param threadCount - number of threads replaying the trace concurrently
+ * in the contended run, below 2 skips it
+ * @param traceFileName - optional recorded trace, replayed instead of the
+ * generated one
+ */
+void MemoryAllocTrace(int frameCount, int threadCount, char const *traceFileName = 0);
+
+/**
+ * Measures managed_ptr copy and release with the plain and the atomic
+ * reference count policy, on a single thread and with several threads
+ * sharing the same object.
+ * @param iterations - number of copies made by each thread
+ * @param threadCount - number of threads sharing the object in the
+ * contended run, below 2 skips it
+ */
+void ManagedPtrRefCount(int iterations, int threadCount);
+
+}
+
+}
+
+#endif /* BENCHMARK_H_ */
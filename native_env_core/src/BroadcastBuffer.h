@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _BROADCASTBUFFER_H
+#define _BROADCASTBUFFER_H
+
+/**
+ * @file
+ *
+ * Definition of BroadcastBuffer
+ */
+
+#include <sched.h>
+#include <atomic>
+#include "Base.h"
+#include "SystemCore.h"
+#include "FrameRing.h"
+
+namespace System
+{
+
+/**
+ * Single producer, multiple consumer latest-frame buffer. Every consumer
+ * (e.g. renderer, tracker and recorder) owns a BroadcastBuffer::Reader and
+ * sees the most recently published frame without copying it. Slots are
+ * reference counted: a slot is reused by the producer only after all
+ * readers holding it have moved on. Each reader holds at most one slot,
+ * so with MaxReaderCount + 2 slots the producer always finds a free slot
+ * and never waits for a reader, and readers never wait for each other.
+ */
+template<class T, int MaxReaderCount> class BroadcastBuffer
+{
+    enum
+    {
+        SlotCount = MaxReaderCount + 2
+    };
+
+public:
+    /**
+     * Consumer handle. Each consumer thread needs its own Reader.
+     */
+    class Reader
+    {
+    public:
+        Reader(BroadcastBuffer &buffer)
+                : mBuffer(buffer), mSlot(-1)
+        {
+            mFrameInfo.sequence = 0;
+            mFrameInfo.timestamp = 0.0;
+
+            if (mBuffer.mReaderCount.fetch_add(1) >= MaxReaderCount)
+            {
+                LOG_DEBUG_TRAP(LOG_LIB, "too many BroadcastBuffer readers!");
+            }
+        }
+
+        ~Reader(void)
+        {
+            release();
+            mBuffer.mReaderCount.fetch_sub(1);
+        }
+
+        /**
+         * Acquires the most recently published frame and releases the one
+         * held so far. The frame stays valid till the next acquire or release.
+         * @param fresh - optional, set to true if the frame was not seen before
+         * @return pointer to the frame or null if nothing has been published yet
+         */
+        T const *acquireLatestFrame(bool *fresh = 0)
+        {
+            // release first, so that a reader never holds two slots and
+            // MaxReaderCount + 2 slots stay enough for the producer
+            release();
+            mSlot = mBuffer.acquireSlot();
+
+            if (mSlot < 0)
+            {
+                if (fresh != 0)
+                {
+                    *fresh = false;
+                }
+                return 0;
+            }
+
+            FrameInfo const &info = mBuffer.mSlotInfo[mSlot];
+            if (fresh != 0)
+            {
+                *fresh = info.sequence != mFrameInfo.sequence;
+            }
+            mFrameInfo = info;
+
+            return &mBuffer.mSlots[mSlot];
+        }
+
+        /**
+         * Gets the sequence number and capture time of the last acquired frame.
+         */
+        FrameInfo const &getFrameInfo(void) const
+        {
+            return mFrameInfo;
+        }
+
+        /**
+         * Releases the held frame, so that the producer can reuse its slot.
+         */
+        void release(void)
+        {
+            if (mSlot >= 0)
+            {
+                mBuffer.releaseSlot(mSlot);
+                mSlot = -1;
+            }
+        }
+
+    private:
+        Reader(Reader const &);
+        Reader &operator=(Reader const &);
+
+        BroadcastBuffer &mBuffer;
+        int mSlot;
+        FrameInfo mFrameInfo;
+    };
+
+    /**
+     * Default constructor.
+     */
+    BroadcastBuffer(void)
+            : mProducerSlot(0), mNextSequence(1), mLatestSlot(-1), mReaderCount(0)
+    {
+        for (int i = 0; i < SlotCount; i++)
+        {
+            mSlotInfo[i].sequence = 0;
+            mSlotInfo[i].timestamp = 0.0;
+            mRefCount[i].store(0);
+        }
+    }
+
+    ~BroadcastBuffer(void)
+    {
+    }
+
+    /**
+     * Gets the slot owned by the producer for writing in place. Only the
+     * producer thread may call it.
+     * @return writable back buffer
+     */
+    T &getBackBuffer(void)
+    {
+        return mSlots[mProducerSlot];
+    }
+
+    /**
+     * Publishes the back buffer to all readers and hands the producer a
+     * slot that no reader holds.
+     * @param timestamp - capture time of the published frame
+     * @return the new writable back buffer
+     */
+    T &publishBackBuffer(double timestamp)
+    {
+        int const published = mProducerSlot;
+        mSlotInfo[published].sequence = mNextSequence++;
+        mSlotInfo[published].timestamp = timestamp;
+        mLatestSlot.store(published);
+
+        int slot = findFreeSlot(published);
+        if (slot < 0)
+        {
+            // only reachable with more than MaxReaderCount readers: wait for
+            // one of them to move on rather than overwrite a frame it reads
+            LOG_DEBUG_TRAP(LOG_LIB, "no free BroadcastBuffer slot!");
+            while ((slot = findFreeSlot(published)) < 0)
+            {
+                sched_yield();
+            }
+        }
+
+        mProducerSlot = slot;
+        return mSlots[slot];
+    }
+
+    /**
+     * Returns the number of frames published so far.
+     */
+    uint64 getPublishedFrameCount(void) const
+    {
+        return mNextSequence - 1;
+    }
+
+private:
+    BroadcastBuffer(BroadcastBuffer const &);
+    BroadcastBuffer &operator=(BroadcastBuffer const &);
+
+    // readers re-check the latest slot after taking a reference, so a slot
+    // seen unreferenced here cannot be picked up while the producer writes it
+    int findFreeSlot(int published) const
+    {
+        for (int i = 0; i < SlotCount; i++)
+        {
+            if (i != published && mRefCount[i].load() == 0)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    int acquireSlot(void)
+    {
+        for (;;)
+        {
+            int const slot = mLatestSlot.load();
+            if (slot < 0)
+            {
+                return -1;
+            }
+
+            mRefCount[slot].fetch_add(1);
+            if (mLatestSlot.load() == slot)
+            {
+                return slot;
+            }
+
+            // producer published in between, the slot might be rewritten
+            mRefCount[slot].fetch_sub(1);
+        }
+    }
+
+    void releaseSlot(int slot)
+    {
+        mRefCount[slot].fetch_sub(1, std::memory_order_release);
+    }
+
+    T mSlots[SlotCount];
+    FrameInfo mSlotInfo[SlotCount];
+    std::atomic<int> mRefCount[SlotCount];
+
+    int mProducerSlot;
+    uint64 mNextSequence;
+    std::atomic<int> mLatestSlot;
+    std::atomic<int> mReaderCount;
+};
+
+}
+
+#endif
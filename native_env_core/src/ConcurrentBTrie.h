@@ -0,0 +1,676 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _CONCURRENTBTRIE_H
+#define _CONCURRENTBTRIE_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include "Base.h"
+#include "SystemCore.h"
+#include "BTrie.h"
+#include "Delegate.h"
+#include "IntrusiveQueue.h"
+
+namespace NVR
+{
+
+/**
+ * Node type of ConcurrentBTrie. Same bucketing as BTrieNode, but the child
+ * links are atomic and the key must not change while the node is in the
+ * trie. The queue link is used to keep the node on the retired list.
+ */
+template<typename T, typename K> class ConcurrentBTrieNode: public IntrusiveQueueNode<T>
+{
+    static_assert(sizeof(K) == sizeof(uint) || sizeof(K) == sizeof(uint64),
+                  "ConcurrentBTrieNode needs 32 or 64-bit keys");
+
+public:
+    typedef K KeyType;
+    typedef T* NodePtr;
+
+    enum
+    {
+        KeyBucketCount = sizeof(KeyType) * 8
+    };
+
+    ConcurrentBTrieNode(void)
+            : mKey(0), mRetireEpoch(0)
+    {
+    }
+
+    ConcurrentBTrieNode(KeyType key)
+            : mKey(key), mRetireEpoch(0)
+    {
+    }
+
+    ~ConcurrentBTrieNode(void)
+    {
+    }
+
+    FORCE_INLINE KeyType key(void) const
+    {
+        return mKey;
+    }
+
+    FORCE_INLINE KeyType &key(void)
+    {
+        return mKey;
+    }
+
+    FORCE_INLINE NodePtr child(int num) const
+    {
+        return mChild[num].load(std::memory_order_acquire);
+    }
+
+    FORCE_INLINE void setChild(int num, NodePtr node)
+    {
+        mChild[num].store(node, std::memory_order_release);
+    }
+
+    FORCE_INLINE uint64 retireEpoch(void) const
+    {
+        return mRetireEpoch;
+    }
+
+    FORCE_INLINE uint64 &retireEpoch(void)
+    {
+        return mRetireEpoch;
+    }
+
+    FORCE_INLINE static int GetKeyBucketIndex(KeyType key)
+    {
+        return key == 0 ? (KeyBucketCount - 1) : CountLeadingZeros(key);
+    }
+
+    FORCE_INLINE static KeyType GetBucketRootMask(int bindex)
+    {
+        return (static_cast<KeyType>(1) << (KeyBucketCount - 1 - bindex)) >> 1;
+    }
+
+protected:
+    KeyType mKey;
+    std::atomic<NodePtr> mChild[2];
+    uint64 mRetireEpoch;
+
+private:
+    ConcurrentBTrieNode(ConcurrentBTrieNode const &);
+    ConcurrentBTrieNode &operator=(ConcurrentBTrieNode const &);
+};
+
+/**
+ * Read-mostly variant of BTrie. Any number of registered readers run
+ * get(), lowerBound() and visitRange() without taking a lock, while
+ * writers insert and remove under an internal mutex.
+ *
+ * Removed nodes are not handed back immediately: a reader may still be
+ * looking at them. They are kept on a retired list tagged with the global
+ * epoch and passed to the reclaim delegate once every reader that could
+ * have seen them has left its ReadGuard.
+ *
+ * remove() moves a leaf into the place of the removed node, so a reader
+ * racing with it could miss the leaf. Removes bump a sequence counter and
+ * readers that did not find their key, or computed a bound, retry if the
+ * counter changed.
+ */
+template<typename T, int MaxReaderCount = 16> class ConcurrentBTrie
+{
+public:
+    typedef typename T::NodePtr NodePtr;
+    typedef typename T::KeyType KeyType;
+    typedef Delegate<void, NodePtr> ReclaimDelegate;
+
+    class ReadGuard;
+
+    /**
+     * Registration of a reader thread. Each thread that reads from the trie
+     * owns one Reader for as long as it reads. With MaxReaderCount readers
+     * registered, the constructor waits until one of them is destroyed.
+     */
+    class Reader
+    {
+    public:
+        Reader(ConcurrentBTrie &trie)
+                : mTrie(trie), mSlot(claimSlot())
+        {
+            if (mSlot < 0)
+            {
+                // more than MaxReaderCount readers: wait for one of them to
+                // go away rather than read without publishing an epoch
+                LOG_DEBUG_TRAP(LOG_LIB, "too many ConcurrentBTrie readers!");
+                while ((mSlot = claimSlot()) < 0)
+                {
+                    sched_yield();
+                }
+            }
+        }
+
+        ~Reader(void)
+        {
+            mTrie.mReaderEpoch[mSlot].store(SlotFree, std::memory_order_release);
+        }
+
+    private:
+        Reader(Reader const &);
+        Reader &operator=(Reader const &);
+
+        int claimSlot(void)
+        {
+            for (int i = 0; i < MaxReaderCount; i++)
+            {
+                uint64 expected = SlotFree;
+                if (mTrie.mReaderEpoch[i].compare_exchange_strong(expected, SlotIdle))
+                {
+                    return i;
+                }
+            }
+
+            return -1;
+        }
+
+        friend class ConcurrentBTrie;
+        friend class ReadGuard;
+
+        ConcurrentBTrie &mTrie;
+        int mSlot;
+    };
+
+    /**
+     * Read-side critical section. Nodes returned by the trie stay valid
+     * until the guard is destroyed. Guards must not be nested.
+     */
+    class ReadGuard
+    {
+    public:
+        ReadGuard(Reader &reader)
+                : mReader(reader)
+        {
+            mReader.mTrie.mReaderEpoch[mReader.mSlot].store(mReader.mTrie.mEpoch.load(), std::memory_order_relaxed);
+
+            // pairs with the fence in collectRetired(): either the writer sees
+            // our epoch, or we see the links it changed before scanning
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        ~ReadGuard(void)
+        {
+            mReader.mTrie.mReaderEpoch[mReader.mSlot].store(SlotIdle, std::memory_order_release);
+        }
+
+    private:
+        ReadGuard(ReadGuard const &);
+        ReadGuard &operator=(ReadGuard const &);
+
+        Reader &mReader;
+    };
+
+    /**
+     * Default constructor.
+     * @param reclaim - called with every removed node once no reader can access it
+     */
+    ConcurrentBTrie(ReclaimDelegate reclaim = ReclaimDelegate())
+            : mReclaim(reclaim), mVersion(0), mEpoch(FirstEpoch)
+    {
+        pthread_mutex_init(&mWriteLock, 0);
+
+        for (int i = 0; i < T::KeyBucketCount; i++)
+        {
+            mBuckets[i].store(0);
+        }
+
+        for (int i = 0; i < MaxReaderCount; i++)
+        {
+            mReaderEpoch[i].store(SlotFree);
+        }
+    }
+
+    /**
+     * Default destructor. All readers must be gone; the retired nodes are
+     * reclaimed, the nodes still in the trie are left to the caller.
+     */
+    ~ConcurrentBTrie(void)
+    {
+        while (!mRetired.empty())
+        {
+            NodePtr node = mRetired.pop();
+            if (mReclaim)
+            {
+                mReclaim(node);
+            }
+        }
+
+        pthread_mutex_destroy(&mWriteLock);
+    }
+
+    // ==========================================================================
+    // WRITER SIDE
+    // ==========================================================================
+
+    /**
+     * Inserts a node.
+     * @return the inserted node, or the node already in the trie with the same key
+     */
+    NodePtr insert(NodePtr node)
+    {
+        KeyType nodeKey = node->key();
+        int bindex = T::GetKeyBucketIndex(nodeKey);
+        KeyType mask = T::GetBucketRootMask(bindex);
+
+        node->setChild(0, 0);
+        node->setChild(1, 0);
+
+        pthread_mutex_lock(&mWriteLock);
+
+        std::atomic<NodePtr> *link = &mBuckets[bindex];
+        NodePtr currentNode = link->load(std::memory_order_relaxed);
+        NodePtr parentNode = 0;
+        int parentChild = 0;
+
+        while (currentNode != 0)
+        {
+            if (currentNode->key() == nodeKey)
+            {
+                pthread_mutex_unlock(&mWriteLock);
+                return currentNode;
+            }
+            parentNode = currentNode;
+            parentChild = (nodeKey & mask) != 0;
+            currentNode = currentNode->child(parentChild);
+            mask >>= 1;
+        }
+
+        // the node is fully initialized before it becomes visible
+        if (parentNode != 0)
+        {
+            parentNode->setChild(parentChild, node);
+        }
+        else
+        {
+            link->store(node, std::memory_order_release);
+        }
+
+        pthread_mutex_unlock(&mWriteLock);
+
+        return node;
+    }
+
+    /**
+     * Removes the node with the given key. The node is passed to the reclaim
+     * delegate later, when no reader can access it anymore.
+     * @return true if the key was found
+     */
+    bool remove(KeyType key)
+    {
+        int bindex = T::GetKeyBucketIndex(key);
+        KeyType mask = T::GetBucketRootMask(bindex);
+
+        pthread_mutex_lock(&mWriteLock);
+
+        NodePtr parentNode = 0;
+        int parentChild = 0;
+        NodePtr currentNode = mBuckets[bindex].load(std::memory_order_relaxed);
+
+        while (currentNode != 0)
+        {
+            if (currentNode->key() == key)
+            {
+                break;
+            }
+            parentNode = currentNode;
+            parentChild = (key & mask) != 0;
+            currentNode = currentNode->child(parentChild);
+            mask >>= 1;
+        }
+
+        if (currentNode == 0)
+        {
+            pthread_mutex_unlock(&mWriteLock);
+            return false;
+        }
+
+        // find any leaf node below the removed one
+        NodePtr leafParentNode = 0;
+        int leafParentChild = 0;
+        NodePtr leafNode = currentNode;
+        for (;;)
+        {
+            int const num = leafNode->child(0) != 0 ? 0 : 1;
+            NodePtr childNode = leafNode->child(num);
+            if (childNode == 0)
+            {
+                break;
+            }
+            leafParentNode = leafNode;
+            leafParentChild = num;
+            leafNode = childNode;
+        }
+
+        mVersion.fetch_add(1);
+
+        if (leafNode != currentNode)
+        {
+            // detach the leaf, give it the children of the removed node and
+            // publish it in its place; the removed node keeps its links, so
+            // readers standing on it can continue
+            leafParentNode->setChild(leafParentChild, 0);
+            leafNode->setChild(0, currentNode->child(0));
+            leafNode->setChild(1, currentNode->child(1));
+            setLink(bindex, parentNode, parentChild, leafNode);
+        }
+        else
+        {
+            setLink(bindex, parentNode, parentChild, 0);
+        }
+
+        mVersion.fetch_add(1, std::memory_order_release);
+
+        currentNode->retireEpoch() = mEpoch.fetch_add(1);
+        mRetired.push(currentNode);
+        collectRetired();
+
+        pthread_mutex_unlock(&mWriteLock);
+
+        return true;
+    }
+
+    /**
+     * Reclaims the removed nodes that no reader can access anymore.
+     */
+    void collect(void)
+    {
+        pthread_mutex_lock(&mWriteLock);
+        collectRetired();
+        pthread_mutex_unlock(&mWriteLock);
+    }
+
+    /**
+     * Waits until every removed node has been reclaimed. Must not be called
+     * from within a ReadGuard.
+     */
+    void synchronize(void)
+    {
+        for (;;)
+        {
+            pthread_mutex_lock(&mWriteLock);
+            collectRetired();
+            bool const done = mRetired.empty();
+            pthread_mutex_unlock(&mWriteLock);
+
+            if (done)
+            {
+                break;
+            }
+            sched_yield();
+        }
+    }
+
+    // ==========================================================================
+    // READER SIDE (within a ReadGuard)
+    // ==========================================================================
+
+    NodePtr get(KeyType key) const
+    {
+        int bindex = T::GetKeyBucketIndex(key);
+
+        for (;;)
+        {
+            uint const version = beginRead();
+
+            KeyType mask = T::GetBucketRootMask(bindex);
+            NodePtr currentNode = mBuckets[bindex].load(std::memory_order_acquire);
+
+            while (currentNode != 0)
+            {
+                if (currentNode->key() == key)
+                {
+                    return currentNode;
+                }
+                currentNode = currentNode->child((key & mask) != 0);
+                mask >>= 1;
+            }
+
+            // a miss is only trusted if no remove moved nodes meanwhile
+            if (validateRead(version))
+            {
+                return 0;
+            }
+        }
+    }
+
+    bool empty(void) const
+    {
+        for (int i = 0; i < T::KeyBucketCount; i++)
+        {
+            if (mBuckets[i].load(std::memory_order_acquire) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Finds the node with the smallest key not less than the given key,
+     * see BTrie::lowerBound().
+     */
+    NodePtr lowerBound(KeyType key) const
+    {
+        for (;;)
+        {
+            uint const version = beginRead();
+            NodePtr rval = findLowerBound(key);
+            if (validateRead(version))
+            {
+                return rval;
+            }
+        }
+    }
+
+    /**
+     * Finds the node with the smallest key greater than the given key.
+     */
+    NodePtr upperBound(KeyType key) const
+    {
+        if (key == static_cast<KeyType>(~static_cast<KeyType>(0)))
+        {
+            return 0;
+        }
+
+        return lowerBound(key + 1);
+    }
+
+    /**
+     * Calls the visitor for every node with a key in [first, last], in
+     * ascending key order. Nodes inserted or removed concurrently may or
+     * may not be visited, every other node is visited exactly once.
+     */
+    template<typename V> void visitRange(KeyType first, KeyType last, V &visitor) const
+    {
+        NodePtr currentNode = lowerBound(first);
+        while (currentNode != 0)
+        {
+            KeyType currentKey = currentNode->key();
+            if (currentKey > last)
+            {
+                break;
+            }
+
+            visitor(currentNode);
+
+            if (currentKey == last)
+            {
+                break;
+            }
+            currentNode = lowerBound(currentKey + 1);
+        }
+    }
+
+private:
+    ConcurrentBTrie(ConcurrentBTrie const &);
+    ConcurrentBTrie &operator=(ConcurrentBTrie const &);
+
+    // reader slot states, active readers store the epoch they entered at
+    static uint64 const SlotFree = 0;
+    static uint64 const SlotIdle = 1;
+    static uint64 const FirstEpoch = 2;
+
+    FORCE_INLINE uint beginRead(void) const
+    {
+        uint version;
+        while (((version = mVersion.load(std::memory_order_acquire)) & 1) != 0)
+        {
+            // a remove is in progress, it only takes a few stores
+        }
+
+        return version;
+    }
+
+    FORCE_INLINE bool validateRead(uint version) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return mVersion.load(std::memory_order_relaxed) == version;
+    }
+
+    // must be called with mWriteLock held
+    void setLink(int bindex, NodePtr parentNode, int parentChild, NodePtr node)
+    {
+        if (parentNode != 0)
+        {
+            parentNode->setChild(parentChild, node);
+        }
+        else
+        {
+            mBuckets[bindex].store(node, std::memory_order_release);
+        }
+    }
+
+    // must be called with mWriteLock held
+    void collectRetired(void)
+    {
+        if (mRetired.empty())
+        {
+            return;
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // a node retired at epoch E may still be seen by readers that entered at E or before
+        uint64 minimumEpoch = ~static_cast<uint64>(0);
+        for (int i = 0; i < MaxReaderCount; i++)
+        {
+            uint64 const epoch = mReaderEpoch[i].load(std::memory_order_relaxed);
+            if (epoch >= FirstEpoch && epoch < minimumEpoch)
+            {
+                minimumEpoch = epoch;
+            }
+        }
+
+        // the list is ordered by epoch
+        while (!mRetired.empty() && mRetired.front()->retireEpoch() < minimumEpoch)
+        {
+            NodePtr node = mRetired.pop();
+            if (mReclaim)
+            {
+                mReclaim(node);
+            }
+        }
+    }
+
+    NodePtr findLowerBound(KeyType key) const
+    {
+        int bindex = T::GetKeyBucketIndex(key);
+        KeyType mask = T::GetBucketRootMask(bindex);
+        NodePtr currentNode = mBuckets[bindex].load(std::memory_order_acquire);
+        NodePtr candidateNode = 0;
+        NodePtr skippedSubtree = 0;
+
+        while (currentNode != 0)
+        {
+            KeyType currentKey = currentNode->key();
+            if (currentKey == key)
+            {
+                return currentNode;
+            }
+            if (currentKey > key && (candidateNode == 0 || currentKey < candidateNode->key()))
+            {
+                candidateNode = currentNode;
+            }
+
+            int const bit = (key & mask) != 0;
+            NodePtr const largerSubtree = currentNode->child(1);
+            if (bit == 0 && largerSubtree != 0)
+            {
+                skippedSubtree = largerSubtree;
+            }
+            currentNode = bit == 0 ? currentNode->child(0) : largerSubtree;
+            mask >>= 1;
+        }
+
+        if (skippedSubtree != 0)
+        {
+            NodePtr subtreeMinimum = getSubtreeMinimum(skippedSubtree);
+            if (candidateNode == 0 || subtreeMinimum->key() < candidateNode->key())
+            {
+                candidateNode = subtreeMinimum;
+            }
+        }
+
+        if (candidateNode != 0)
+        {
+            return candidateNode;
+        }
+
+        for (int i = bindex - 1; i >= 0; i--)
+        {
+            NodePtr rootNode = mBuckets[i].load(std::memory_order_acquire);
+            if (rootNode != 0)
+            {
+                return getSubtreeMinimum(rootNode);
+            }
+        }
+
+        return 0;
+    }
+
+    static NodePtr getSubtreeMinimum(NodePtr currentNode)
+    {
+        NodePtr candidateNode = currentNode;
+
+        while (currentNode != 0)
+        {
+            if (currentNode->key() < candidateNode->key())
+            {
+                candidateNode = currentNode;
+            }
+
+            NodePtr childNode = currentNode->child(0);
+            currentNode = childNode != 0 ? childNode : currentNode->child(1);
+        }
+
+        return candidateNode;
+    }
+
+    std::atomic<NodePtr> mBuckets[T::KeyBucketCount];
+
+    ReclaimDelegate mReclaim;
+    IntrusiveQueue<T> mRetired; // removed nodes, oldest first
+
+    std::atomic<uint> mVersion; // odd while a remove is relinking nodes
+    std::atomic<uint64> mEpoch;
+    std::atomic<uint64> mReaderEpoch[MaxReaderCount];
+
+    pthread_mutex_t mWriteLock;
+};
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include "SystemCore.h"
+#include "ConcurrentBlockAllocator.h"
+
+System::ConcurrentBlockAllocator::ConcurrentBlockAllocator(uint blockSize, uint magazineSize, uint initialCapacity,
+                                                           uint allocFlags)
+        : mBlockSize(blockSize > sizeof(BlockHeader) ? blockSize : sizeof(BlockHeader)),
+          mMagazineSize(magazineSize < 1 ? 1 : magazineSize), mThreadCacheKey(), mDepotLock(),
+          mBlocks(mBlockSize, initialCapacity, 0, allocFlags), mFullMagazines(0), mThreadCaches(0)
+{
+    pthread_mutex_init(&mDepotLock, 0);
+    pthread_key_create(&mThreadCacheKey, &ReleaseThreadCache);
+}
+
+System::ConcurrentBlockAllocator::~ConcurrentBlockAllocator(void)
+{
+    // threads still alive won't call ReleaseThreadCache() anymore
+    pthread_key_delete(mThreadCacheKey);
+
+    // blocks are owned by mBlocks, only the caches themselves need freeing
+    while (mThreadCaches != 0)
+    {
+        ThreadCache *next = mThreadCaches->nextCache;
+        MemoryFree(mThreadCaches);
+        mThreadCaches = next;
+    }
+
+    pthread_mutex_destroy(&mDepotLock);
+}
+
+void System::ConcurrentBlockAllocator::flushThreadCache(void)
+{
+    ThreadCache *cache = static_cast<ThreadCache *>(pthread_getspecific(mThreadCacheKey));
+    if (cache == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mDepotLock);
+    flushMagazine(cache->loaded);
+    flushMagazine(cache->previous);
+    pthread_mutex_unlock(&mDepotLock);
+}
+
+size_t System::ConcurrentBlockAllocator::trim(void)
+{
+    pthread_mutex_lock(&mDepotLock);
+
+    while (mFullMagazines != 0)
+    {
+        BlockHeader *block = mFullMagazines;
+        mFullMagazines = mFullMagazines->nextMagazine;
+
+        while (block != 0)
+        {
+            BlockHeader *next = block->next;
+            mBlocks.deallocate(reinterpret_cast<uchar *>(block));
+            block = next;
+        }
+    }
+
+    size_t const releasedSize = mBlocks.trim();
+
+    pthread_mutex_unlock(&mDepotLock);
+
+    return releasedSize;
+}
+
+int System::ConcurrentBlockAllocator::getCapacity(void) const
+{
+    pthread_mutex_lock(&mDepotLock);
+    int const capacity = mBlocks.getCapacity();
+    pthread_mutex_unlock(&mDepotLock);
+
+    return capacity;
+}
+
+System::ConcurrentBlockAllocator::ThreadCache *System::ConcurrentBlockAllocator::createThreadCache(void)
+{
+    ThreadCache *cache = MemoryAlloc<ThreadCache>(1, CACHELINE_ALIGNMENT);
+    cache->owner = this;
+    cache->loaded.top = 0;
+    cache->loaded.count = 0;
+    cache->previous.top = 0;
+    cache->previous.count = 0;
+    cache->prevCache = 0;
+
+    pthread_mutex_lock(&mDepotLock);
+    cache->nextCache = mThreadCaches;
+    if (mThreadCaches != 0)
+    {
+        mThreadCaches->prevCache = cache;
+    }
+    mThreadCaches = cache;
+    pthread_mutex_unlock(&mDepotLock);
+
+    pthread_setspecific(mThreadCacheKey, cache);
+
+    return cache;
+}
+
+void System::ConcurrentBlockAllocator::refill(ThreadCache *cache)
+{
+    // both magazines are empty
+    pthread_mutex_lock(&mDepotLock);
+
+    if (mFullMagazines != 0)
+    {
+        cache->loaded.top = mFullMagazines;
+        cache->loaded.count = mMagazineSize;
+        mFullMagazines = mFullMagazines->nextMagazine;
+    }
+    else
+    {
+        // no full magazine to take, carve a new one
+        BlockHeader *top = 0;
+        for (int i = 0; i < mMagazineSize; i++)
+        {
+            BlockHeader *block = unsafe_pointer_cast<BlockHeader>(mBlocks.allocate());
+            block->next = top;
+            top = block;
+        }
+
+        cache->loaded.top = top;
+        cache->loaded.count = mMagazineSize;
+    }
+
+    pthread_mutex_unlock(&mDepotLock);
+}
+
+void System::ConcurrentBlockAllocator::spill(ThreadCache *cache)
+{
+    // both magazines are full, hand the older one over to the depot
+    pthread_mutex_lock(&mDepotLock);
+    cache->previous.top->nextMagazine = mFullMagazines;
+    mFullMagazines = cache->previous.top;
+    pthread_mutex_unlock(&mDepotLock);
+
+    cache->previous = cache->loaded;
+    cache->loaded.top = 0;
+    cache->loaded.count = 0;
+}
+
+void System::ConcurrentBlockAllocator::flushMagazine(Magazine &magazine)
+{
+    // called with mDepotLock held
+    if (magazine.count == mMagazineSize)
+    {
+        magazine.top->nextMagazine = mFullMagazines;
+        mFullMagazines = magazine.top;
+    }
+    else
+    {
+        // partial magazines go back to the block allocator free list,
+        // they will be reused by refill()
+        while (magazine.top != 0)
+        {
+            BlockHeader *next = magazine.top->next;
+            mBlocks.deallocate(reinterpret_cast<uchar *>(magazine.top));
+            magazine.top = next;
+        }
+    }
+
+    magazine.top = 0;
+    magazine.count = 0;
+}
+
+void System::ConcurrentBlockAllocator::ReleaseThreadCache(void *arg)
+{
+    ThreadCache *cache = static_cast<ThreadCache *>(arg);
+    ConcurrentBlockAllocator *owner = cache->owner;
+
+    pthread_mutex_lock(&owner->mDepotLock);
+
+    owner->flushMagazine(cache->loaded);
+    owner->flushMagazine(cache->previous);
+
+    if (cache->prevCache != 0)
+    {
+        cache->prevCache->nextCache = cache->nextCache;
+    }
+    else
+    {
+        owner->mThreadCaches = cache->nextCache;
+    }
+    if (cache->nextCache != 0)
+    {
+        cache->nextCache->prevCache = cache->prevCache;
+    }
+
+    pthread_mutex_unlock(&owner->mDepotLock);
+
+    MemoryFree(cache);
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef CONCURRENTBLOCKALLOCATOR_H_
+#define CONCURRENTBLOCKALLOCATOR_H_
+
+/**
+ * @file
+ * Definition of ConcurrentBlockAllocator.
+ */
+
+#include <pthread.h>
+#include <utility>
+#include "Base.h"
+#include "ManagedPtr.h"
+#include "MemAlloc.h"
+
+namespace System
+{
+
+// default number of blocks cached per thread in one magazine
+#define CONCURRENT_BLOCK_ALLOCATOR_MAGAZINE_SIZE    32
+
+/**
+ * Thread-safe fixed size block allocator. Every thread owns two magazines
+ * (short free lists) of blocks, allocate() and deallocate() only touch the
+ * magazines of the calling thread and take no lock. When both magazines
+ * run empty or full, a whole magazine is exchanged with the shared depot
+ * under a mutex, so the lock is taken at most once per magazine size
+ * operations. New blocks are carved from a BlockAllocator owned by the
+ * depot. Blocks may be freed by a thread other than the one that
+ * allocated them.
+ *
+ * Each instance uses one pthread key, so the allocator is meant for a
+ * handful of long lived pools rather than for many short lived objects.
+ * Thread caches are returned to the depot when their thread exits, the
+ * allocator has to outlive all threads using it or those threads have
+ * to call flushThreadCache() before it is destroyed.
+ */
+class ConcurrentBlockAllocator: public ManagedAbstractObject
+{
+    typedef struct BlockHeaderStruct
+    {
+        struct BlockHeaderStruct *next;
+        struct BlockHeaderStruct *nextMagazine; // valid on top of full magazines in the depot
+    } BlockHeader;
+
+    typedef struct MagazineStruct
+    {
+        BlockHeader *top;
+        int count;
+    } Magazine;
+
+    typedef struct ThreadCacheStruct
+    {
+        ConcurrentBlockAllocator *owner;
+        Magazine loaded;
+        Magazine previous;
+        struct ThreadCacheStruct *prevCache;
+        struct ThreadCacheStruct *nextCache;
+    } ThreadCache;
+
+public:
+    /**
+     * Default constructor.
+     * @param blockSize - size of one block in bytes
+     * @param magazineSize - number of blocks exchanged with the depot at once
+     * @param initialCapacity - number of blocks allocated up front
+     * @param allocFlags - MemoryAlloc() flags used for the segments
+     */
+    ConcurrentBlockAllocator(uint blockSize, uint magazineSize = CONCURRENT_BLOCK_ALLOCATOR_MAGAZINE_SIZE,
+            uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY, uint allocFlags = MEMORY_ALLOC_DEFAULT);
+    ~ConcurrentBlockAllocator(void);
+
+    uchar *allocate(void)
+    {
+        ThreadCache *cache = getThreadCache();
+
+        if (cache->loaded.count == 0)
+        {
+            if (cache->previous.count > 0)
+            {
+                swapMagazines(cache);
+            }
+            else
+            {
+                refill(cache);
+            }
+        }
+
+        BlockHeader *block = cache->loaded.top;
+        cache->loaded.top = block->next;
+        cache->loaded.count--;
+
+        return reinterpret_cast<uchar *>(block);
+    }
+
+    void deallocate(uchar *ptr)
+    {
+        ThreadCache *cache = getThreadCache();
+
+        if (cache->loaded.count == mMagazineSize)
+        {
+            if (cache->previous.count < mMagazineSize)
+            {
+                swapMagazines(cache);
+            }
+            else
+            {
+                spill(cache);
+            }
+        }
+
+        BlockHeader *block = unsafe_pointer_cast<BlockHeader>(ptr);
+        block->next = cache->loaded.top;
+        cache->loaded.top = block;
+        cache->loaded.count++;
+    }
+
+    /**
+     * Returns the blocks cached by the calling thread to the depot.
+     */
+    void flushThreadCache(void);
+
+    /**
+     * Returns the full magazines of the depot to the block allocator and
+     * releases its segments that hold no live block. Blocks cached by
+     * threads count as live.
+     * @return number of bytes released
+     */
+    size_t trim(void);
+
+    int getCapacity(void) const;
+
+    int getBlockSize(void) const
+    {
+        return mBlockSize;
+    }
+
+    int getMagazineSize(void) const
+    {
+        return mMagazineSize;
+    }
+
+private:
+    // prevent copy construction and assignment
+    ConcurrentBlockAllocator(ConcurrentBlockAllocator const &instance);
+    ConcurrentBlockAllocator &operator=(ConcurrentBlockAllocator const &instance);
+
+    ThreadCache *getThreadCache(void)
+    {
+        ThreadCache *cache = static_cast<ThreadCache *>(pthread_getspecific(mThreadCacheKey));
+        if (cache == 0)
+        {
+            cache = createThreadCache();
+        }
+
+        return cache;
+    }
+
+    static void swapMagazines(ThreadCache *cache)
+    {
+        Magazine const tmp = cache->loaded;
+        cache->loaded = cache->previous;
+        cache->previous = tmp;
+    }
+
+    ThreadCache *createThreadCache(void);
+    void refill(ThreadCache *cache);
+    void spill(ThreadCache *cache);
+    void flushMagazine(Magazine &magazine);
+
+    // pthread key destructor, called on thread exit
+    static void ReleaseThreadCache(void *arg);
+
+    const int mBlockSize;
+    const int mMagazineSize;
+
+    pthread_key_t mThreadCacheKey;
+
+    // depot, protected by mDepotLock
+    mutable pthread_mutex_t mDepotLock;
+    BlockAllocator mBlocks;
+    BlockHeader *mFullMagazines;
+    ThreadCache *mThreadCaches;
+};
+
+template<typename T> class ConcurrentTypedBlockAllocator: protected ConcurrentBlockAllocator
+{
+public:
+    ConcurrentTypedBlockAllocator(uint magazineSize = CONCURRENT_BLOCK_ALLOCATOR_MAGAZINE_SIZE,
+            uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY, uint allocFlags = MEMORY_ALLOC_DEFAULT)
+            : ConcurrentBlockAllocator(sizeof(T), magazineSize, initialCapacity, allocFlags)
+    {
+    }
+
+    template<typename ... Args> T *allocate(Args &&... args)
+    {
+        // allocate
+        T *instance = reinterpret_cast<T *>(ConcurrentBlockAllocator::allocate());
+        // construct instance from the arguments
+        new (static_cast<void *>(instance)) T(std::forward<Args>(args)...);
+        return instance;
+    }
+
+    void deallocate(T *ptr)
+    {
+        // destroy instance
+        ptr->~T();
+        // deallocate
+        ConcurrentBlockAllocator::deallocate(reinterpret_cast<uchar *>(ptr));
+    }
+
+    void flushThreadCache(void)
+    {
+        ConcurrentBlockAllocator::flushThreadCache();
+    }
+
+    size_t trim(void)
+    {
+        return ConcurrentBlockAllocator::trim();
+    }
+
+    int getCapacity(void) const
+    {
+        return ConcurrentBlockAllocator::getCapacity();
+    }
+
+private:
+    // prevent copy construction and assignment
+    ConcurrentTypedBlockAllocator(ConcurrentTypedBlockAllocator const &instance);
+    ConcurrentTypedBlockAllocator &operator=(ConcurrentTypedBlockAllocator const &instance);
+};
+
+}
+
+#endif /* CONCURRENTBLOCKALLOCATOR_H_ */
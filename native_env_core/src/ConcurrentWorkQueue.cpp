@@ -22,7 +22,8 @@ typedef struct ThreadDataStruct
 }
 
 System::ConcurrentWorkQueue::ConcurrentWorkQueue(const uint poolSize)
-        : mPendingJobs(), mPendingJobsAllocator(sizeof(PendingJob)), mNextJobId(1), mFinalized(false), mTaskQueue(),
+        : mPendingJobs(), mPendingJobsAllocator(sizeof(PendingJob)), mNextJobId(1), mFinalized(false),
+          mTaskAllocator(), mTaskQueue(),
           mJobFinishedSignal(), mAccessLock(), mThreadData(new ThreadData[poolSize]), mThreadPoolSize(poolSize)
 {
     // initialize mutex and cond
@@ -140,15 +141,18 @@ uint System::ConcurrentWorkQueue::enqueue(TaskExecutor *job)
 
     pthread_mutex_unlock(&mAccessLock);
 
-    // add tasks to the thread-safe queue
-    std::vector<Task> taskArray(taskCount);
+    // the task pool is thread-safe, no need to hold the lock
+    NVR::IntrusiveQueue<Task> taskChain;
     for (uint i = 0; i < taskCount; i++)
     {
-        taskArray[i].index = i;
-        taskArray[i].owner = jobData;
+        Task *task = mTaskAllocator.allocate();
+        task->index = i;
+        task->owner = jobData;
+        taskChain.push(task);
     }
 
-    mTaskQueue.produceAll(taskArray);
+    // add tasks to the thread-safe queue
+    mTaskQueue.produceAll(taskChain);
 
     return jobId;
 }
@@ -163,7 +167,7 @@ void *System::ConcurrentWorkQueue::ThreadBody(void *arg)
 void System::ConcurrentWorkQueue::run(int threadIndex)
 {
     (void)threadIndex;
-    Task task;
+    Task *task;
 
     // loop infinitely, waiting for a task in the queue
     while (true)
@@ -175,18 +179,21 @@ void System::ConcurrentWorkQueue::run(int threadIndex)
             break;
         }
 
-        // LOG("thread %i got task %i from job %i...", threadIndex, task.index, task.owner->getJobId());
+        // LOG("thread %i got task %i from job %i...", threadIndex, task->index, task->owner->getJobId());
         // execute task
-        PendingJob *currentJob = task.owner;
-        currentJob->getExecutor()->run(task.index, currentJob->getTotalTaskCount());
-        // LOG("thread %i finished task %i from job %i...", threadIndex, task.index, task.owner->getJobId());
+        PendingJob *currentJob = task->owner;
+        currentJob->getExecutor()->run(task->index, currentJob->getTotalTaskCount());
+        // LOG("thread %i finished task %i from job %i...", threadIndex, task->index, task->owner->getJobId());
+
+        // return the task to the pool
+        mTaskAllocator.deallocate(task);
 
         pthread_mutex_lock(&mAccessLock);
 
         // mask task complete
         if (currentJob->markTaskCompleted())
         {
-//            LOG("thread %i finished job %i...", threadIndex, task.owner->getJobId());
+//            LOG("thread %i finished job %i...", threadIndex, currentJob->getJobId());
             // all tasks in this job are finished
             mPendingJobs.remove(currentJob->getJobId());
             mPendingJobsAllocator.deallocate(reinterpret_cast<uchar *>(currentJob));
@@ -14,6 +14,7 @@
 #include "BTrie.h"
 #include "WorkQueue.h"
 #include "MemAlloc.h"
+#include "ConcurrentBlockAllocator.h"
 
 namespace System
 {
@@ -153,14 +154,23 @@ private:
     uint mNextJobId;
     bool mFinalized;
 
-    // task queue
-    typedef struct
+    // task queue, tasks are pooled and linked intrusively so that
+    // enqueue() and the worker loop never hit the general heap. The pool
+    // is thread-safe, workers return tasks without taking mAccessLock.
+    class Task: public NVR::IntrusiveQueueNode<Task>
     {
+    public:
+        Task(void)
+                : index(0), owner(0)
+        {
+        }
+
         uint index;
         PendingJob *owner;
-    } Task;
+    };
 
-    WorkQueue<Task> mTaskQueue;
+    System::ConcurrentTypedBlockAllocator<Task> mTaskAllocator;
+    IntrusiveWorkQueue<Task> mTaskQueue;
 
     // used to signal that a job is finished.
     pthread_cond_t mJobFinishedSignal;
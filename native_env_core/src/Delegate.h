@@ -11,13 +11,16 @@
 #ifndef DELEGATE_H_
 #define DELEGATE_H_
 
+#include <utility>
+
 namespace NVR {
 
-// simple single argument delegate implementation
-template<typename ReturnType, typename ArgType>
+// delegate to a function or method, e.g. Delegate<void, int, int> for a
+// target taking two ints; it holds two pointers and never allocates
+template<typename ReturnType, typename ... Args>
 class Delegate
 {
-    typedef ReturnType (*StubPtrType)(void *instancePtr, ArgType arg);
+    typedef ReturnType (*StubPtrType)(void *instancePtr, Args ... args);
 
 public:
     Delegate()
@@ -25,27 +28,27 @@ public:
     {
     }
 
-    template<ReturnType (*TMethod)(ArgType)>
+    template<ReturnType (*TMethod)(Args ...)>
     static Delegate CreateFromFunction(void)
     {
         return Delegate(0, &FunctionStub<TMethod>);
     }
 
-    template<class T, ReturnType (T::*TMethod)(ArgType)>
+    template<class T, ReturnType (T::*TMethod)(Args ...)>
     static Delegate CreateFromMethod(T *instancePtr)
     {
         return Delegate(instancePtr, &MethodStub<T, TMethod>);
     }
 
-    template<class T, ReturnType (T::*TMethod)(ArgType) const>
+    template<class T, ReturnType (T::*TMethod)(Args ...) const>
     static Delegate CreateFromConstMethod(T const *instancePtr)
     {
         return Delegate(const_cast<T*>(instancePtr), &ConstMethodStub<T, TMethod>);
     }
 
-    ReturnType operator()(ArgType arg) const
+    ReturnType operator()(Args ... args) const
     {
-        return (*mStubPtr)(mInstancePtr, arg);
+        return (*mStubPtr)(mInstancePtr, std::forward<Args>(args)...);
     }
 
     operator bool() const
@@ -58,30 +61,40 @@ public:
         return !(operator bool());
     }
 
+    bool operator==(Delegate const &rhs) const
+    {
+        return mInstancePtr == rhs.mInstancePtr && mStubPtr == rhs.mStubPtr;
+    }
+
+    bool operator!=(Delegate const &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
 private:
     Delegate(void *instancePtr, StubPtrType stubPtr)
             : mInstancePtr(instancePtr), mStubPtr(stubPtr)
     {
     }
 
-    template<ReturnType (*TMethod)(ArgType)>
-    static ReturnType FunctionStub(void *, ArgType arg)
+    template<ReturnType (*TMethod)(Args ...)>
+    static ReturnType FunctionStub(void *, Args ... args)
     {
-        return (TMethod)(arg);
+        return (TMethod)(std::forward<Args>(args)...);
     }
 
-    template<class T, ReturnType (T::*TMethod)(ArgType)>
-    static ReturnType MethodStub(void *instancePtr, ArgType arg)
+    template<class T, ReturnType (T::*TMethod)(Args ...)>
+    static ReturnType MethodStub(void *instancePtr, Args ... args)
     {
         T *p = static_cast<T*>(instancePtr);
-        return (p->*TMethod)(arg);
+        return (p->*TMethod)(std::forward<Args>(args)...);
     }
 
-    template<class T, ReturnType (T::*TMethod)(ArgType) const>
-    static ReturnType ConstMethodStub(void *instancePtr, ArgType arg)
+    template<class T, ReturnType (T::*TMethod)(Args ...) const>
+    static ReturnType ConstMethodStub(void *instancePtr, Args ... args)
     {
         T const *p = static_cast<T*>(instancePtr);
-        return (p->*TMethod)(arg);
+        return (p->*TMethod)(std::forward<Args>(args)...);
     }
 
     void *mInstancePtr;
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _FRAMERING_H
+#define _FRAMERING_H
+
+/**
+ * @file
+ *
+ * Definition of FrameRing
+ */
+
+#include <pthread.h>
+#include "Base.h"
+
+namespace System
+{
+
+/**
+ * Information attached to every frame published into a FrameRing.
+ */
+struct FrameInfo
+{
+    uint64 sequence; // monotonically increasing, starts at 1 (0 means no frame yet)
+    double timestamp; // capture time provided by the producer
+};
+
+/**
+ * Frame counters of a FrameRing.
+ */
+struct FrameRingStatistics
+{
+    uint64 publishedFrameCount;
+    uint64 consumedFrameCount;
+    uint64 droppedFrameCount; // published, but overwritten or skipped before being consumed
+    uint64 repeatedFrameCount; // consumer asked for a frame, but got the previous one again
+};
+
+/**
+ * Generalization of TripleBuffer to SlotCount slots. The producer owns one
+ * slot that it fills in place, the consumer owns one slot that it reads, and
+ * the remaining slots hold published frames waiting to be consumed. Every
+ * published frame carries a sequence number and a capture timestamp, which
+ * lets us measure capture-to-display latency and pick the pipeline depth.
+ * FrameRing<T, 3> behaves like a TripleBuffer with the consumer always
+ * taking the latest frame.
+ */
+template<class T, int SlotCount = 3> class FrameRing
+{
+    static_assert(SlotCount >= 3 && SlotCount <= 32, "FrameRing needs between 3 and 32 slots");
+
+public:
+    /**
+     * Default constructor.
+     */
+    FrameRing(void)
+            : mProducerSlot(0), mConsumerSlot(1), mPublishedHead(0), mPublishedCount(0), mFreeSlotMask(0),
+              mNextSequence(1), mFinalized(false)
+    {
+        pthread_mutex_init(&mAccessLock, 0);
+        pthread_cond_init(&mPublishSignal, 0);
+
+        for (int i = 0; i < SlotCount; i++)
+        {
+            mSlotInfo[i].sequence = 0;
+            mSlotInfo[i].timestamp = 0.0;
+        }
+
+        for (int i = 2; i < SlotCount; i++)
+        {
+            BIT_SET(mFreeSlotMask, 1u << i);
+        }
+
+        resetStatistics();
+    }
+
+    /**
+     * Default destructor.
+     */
+    ~FrameRing(void)
+    {
+        finalize();
+
+        // XXX: dirty hack, see ~TripleBuffer()
+        pthread_mutex_lock(&mAccessLock);
+        pthread_mutex_unlock(&mAccessLock);
+
+        pthread_mutex_destroy(&mAccessLock);
+        pthread_cond_destroy(&mPublishSignal);
+    }
+
+    /*
+     * Cancel all pending acquire requests and stop publishing.
+     */
+    void finalize()
+    {
+        if (mFinalized)
+        {
+            return;
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+        mFinalized = true;
+        pthread_cond_broadcast(&mPublishSignal);
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    /**
+     * Returns true if buffer is finalized, false otherwise
+     */
+    bool isFinalized(void)
+    {
+        return mFinalized;
+    }
+
+    /**
+     * Gets the slot owned by the producer. Only the producer thread may call it.
+     * The reference is valid till the next call to publishBackBuffer().
+     * @return writable back buffer
+     */
+    T &getBackBuffer(void)
+    {
+        return mSlots[mProducerSlot];
+    }
+
+    /**
+     * Publishes the back buffer and hands the producer a new one. If all
+     * slots are occupied by unconsumed frames, the oldest one is dropped.
+     * @param timestamp - capture time of the published frame
+     * @return the new writable back buffer
+     */
+    T &publishBackBuffer(double timestamp)
+    {
+        if (mFinalized)
+        {
+            return mSlots[mProducerSlot];
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+
+        if (!mFinalized)
+        {
+            mSlotInfo[mProducerSlot].sequence = mNextSequence++;
+            mSlotInfo[mProducerSlot].timestamp = timestamp;
+            mPublished[(mPublishedHead + mPublishedCount) % SlotCount] = mProducerSlot;
+            mPublishedCount++;
+            mStatistics.publishedFrameCount++;
+
+            if (mFreeSlotMask != 0)
+            {
+                mProducerSlot = __builtin_ctz(mFreeSlotMask);
+                BIT_CLEAR(mFreeSlotMask, 1u << mProducerSlot);
+            }
+            else
+            {
+                // ring is full, recycle the oldest unconsumed frame
+                mProducerSlot = popPublished();
+                mStatistics.droppedFrameCount++;
+            }
+
+            pthread_cond_broadcast(&mPublishSignal);
+        }
+
+        T &rval = mSlots[mProducerSlot];
+        pthread_mutex_unlock(&mAccessLock);
+
+        return rval;
+    }
+
+    /**
+     * Makes the most recently published frame the front buffer. Older
+     * unconsumed frames are dropped.
+     * @param blocking - wait for a new frame if none is available
+     * @param fresh - optional, set to true if a new frame was acquired
+     * @return front buffer
+     */
+    T const &acquireLatestFrame(bool blocking, bool *fresh = 0)
+    {
+        return acquireFrame(true, blocking, fresh);
+    }
+
+    /**
+     * Makes the oldest unconsumed frame the front buffer, so that no frame
+     * is dropped as long as the consumer keeps up on average.
+     * @param blocking - wait for a new frame if none is available
+     * @param fresh - optional, set to true if a new frame was acquired
+     * @return front buffer
+     */
+    T const &acquireNextFrame(bool blocking, bool *fresh = 0)
+    {
+        return acquireFrame(false, blocking, fresh);
+    }
+
+    /**
+     * Gets the front buffer. Only the consumer thread may call it. The
+     * reference is valid till the next acquire*Frame() call.
+     * @return front buffer
+     */
+    T const &getFrontBuffer(void) const
+    {
+        return mSlots[mConsumerSlot];
+    }
+
+    /**
+     * Gets the sequence number and capture time of the front buffer. Only
+     * the consumer thread may call it.
+     */
+    FrameInfo const &getFrontFrameInfo(void) const
+    {
+        return mSlotInfo[mConsumerSlot];
+    }
+
+    /**
+     * Returns the number of published frames that wait for the consumer.
+     */
+    int getPendingFrameCount(void)
+    {
+        pthread_mutex_lock(&mAccessLock);
+        int const rval = mPublishedCount;
+        pthread_mutex_unlock(&mAccessLock);
+
+        return rval;
+    }
+
+    void getStatistics(FrameRingStatistics &statistics)
+    {
+        pthread_mutex_lock(&mAccessLock);
+        statistics = mStatistics;
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    void resetStatistics(void)
+    {
+        pthread_mutex_lock(&mAccessLock);
+        mStatistics.publishedFrameCount = 0;
+        mStatistics.consumedFrameCount = 0;
+        mStatistics.droppedFrameCount = 0;
+        mStatistics.repeatedFrameCount = 0;
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+private:
+    FrameRing(FrameRing const &);
+    FrameRing &operator=(FrameRing const &);
+
+    // must be called with mAccessLock held and at least one published frame
+    int popPublished(void)
+    {
+        int const slot = mPublished[mPublishedHead];
+        mPublishedHead = (mPublishedHead + 1) % SlotCount;
+        mPublishedCount--;
+
+        return slot;
+    }
+
+    T const &acquireFrame(bool latest, bool blocking, bool *fresh)
+    {
+        if (mFinalized)
+        {
+            if (fresh != 0)
+            {
+                *fresh = false;
+            }
+            return mSlots[mConsumerSlot];
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+
+        while (mPublishedCount == 0)
+        {
+            if (!blocking || mFinalized)
+            {
+                if (mSlotInfo[mConsumerSlot].sequence != 0 && !mFinalized)
+                {
+                    mStatistics.repeatedFrameCount++;
+                }
+
+                T const &rval = mSlots[mConsumerSlot];
+                pthread_mutex_unlock(&mAccessLock);
+
+                if (fresh != 0)
+                {
+                    *fresh = false;
+                }
+                return rval;
+            }
+            pthread_cond_wait(&mPublishSignal, &mAccessLock);
+        }
+
+        // return the old front buffer to the free pool
+        BIT_SET(mFreeSlotMask, 1u << mConsumerSlot);
+
+        if (latest)
+        {
+            while (mPublishedCount > 1)
+            {
+                BIT_SET(mFreeSlotMask, 1u << popPublished());
+                mStatistics.droppedFrameCount++;
+            }
+        }
+
+        mConsumerSlot = popPublished();
+        mStatistics.consumedFrameCount++;
+
+        T const &rval = mSlots[mConsumerSlot];
+        pthread_mutex_unlock(&mAccessLock);
+
+        if (fresh != 0)
+        {
+            *fresh = true;
+        }
+        return rval;
+    }
+
+    T mSlots[SlotCount];
+    FrameInfo mSlotInfo[SlotCount];
+
+    int mProducerSlot;
+    int mConsumerSlot;
+
+    // published frames, oldest first
+    int mPublished[SlotCount];
+    int mPublishedHead;
+    int mPublishedCount;
+    uint mFreeSlotMask;
+
+    uint64 mNextSequence;
+    FrameRingStatistics mStatistics;
+
+    pthread_mutex_t mAccessLock;
+    pthread_cond_t mPublishSignal;
+    bool mFinalized;
+};
+
+}
+
+#endif
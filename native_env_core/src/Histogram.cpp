@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "Histogram.h"
+#include "SystemCore.h"
+
+#if defined(_MSC_VER)
+#define snprintf _snprintf
+#endif
+
+System::Histogram::Histogram(double unit)
+        : mUnit(unit)
+{
+    reset();
+}
+
+void System::Histogram::add(double value)
+{
+    int bucket = 0;
+    if (value >= mUnit)
+    {
+        int exponent;
+        frexp(value / mUnit, &exponent);
+        bucket = exponent < BucketCount ? exponent : BucketCount - 1;
+    }
+
+    mBuckets[bucket]++;
+    mSum += value;
+    if (mCount == 0 || value < mMin)
+    {
+        mMin = value;
+    }
+    if (mCount == 0 || value > mMax)
+    {
+        mMax = value;
+    }
+    mCount++;
+}
+
+void System::Histogram::reset(void)
+{
+    for (int i = 0; i < BucketCount; i++)
+    {
+        mBuckets[i] = 0;
+    }
+    mCount = 0;
+    mSum = 0.0;
+    mMin = 0.0;
+    mMax = 0.0;
+}
+
+double System::Histogram::getBucketUpperBound(int bucket) const
+{
+    return ldexp(mUnit, bucket);
+}
+
+double System::Histogram::getPercentile(double fraction) const
+{
+    if (mCount == 0)
+    {
+        return 0.0;
+    }
+
+    uint64 const target = static_cast<uint64>(ceil(fraction * mCount));
+    uint64 accumulated = 0;
+    for (int i = 0; i < BucketCount; i++)
+    {
+        accumulated += mBuckets[i];
+        if (accumulated >= target && accumulated != 0)
+        {
+            double const bound = getBucketUpperBound(i);
+            return bound < mMax ? bound : mMax;
+        }
+    }
+
+    return mMax;
+}
+
+void System::Histogram::log(char const *name) const
+{
+    char buffer[256];
+
+    snprintf(buffer, sizeof(buffer), "%s: count %llu, min %.3f, mean %.3f, p50 %.3f, p99 %.3f, max %.3f", name,
+             static_cast<unsigned long long>(mCount), getMin(), getMean(), getPercentile(0.5), getPercentile(0.99),
+             getMax());
+    System::NativeLog(buffer);
+
+    for (int i = 0; i < BucketCount; i++)
+    {
+        if (mBuckets[i] != 0)
+        {
+            snprintf(buffer, sizeof(buffer), "  < %12.3f: %10llu (%5.1f%%)", getBucketUpperBound(i),
+                     static_cast<unsigned long long>(mBuckets[i]), 100.0 * mBuckets[i] / mCount);
+            System::NativeLog(buffer);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+/**
+ * @file
+ * Definition of Histogram.
+ */
+
+#include "Base.h"
+
+namespace System
+{
+
+/**
+ * Fixed-size histogram with power-of-two buckets. Bucket 0 counts values
+ * below the unit, bucket i (i > 0) counts values in [unit * 2^(i-1), unit * 2^i)
+ * and the last bucket also takes everything above. Adding a value never
+ * allocates, so histograms can be updated from the frame loop. The class is
+ * not thread-safe, the owner has to serialize access.
+ */
+class Histogram
+{
+public:
+    enum
+    {
+        BucketCount = 32
+    };
+
+    /**
+     * Default constructor.
+     * @param unit - upper bound of the first bucket (e.g. 0.001 for microseconds when adding milliseconds)
+     */
+    Histogram(double unit = 1.0);
+
+    /**
+     * Adds a value.
+     * @param value - value to add, negative values are counted in bucket 0
+     */
+    void add(double value);
+
+    /**
+     * Removes all values.
+     */
+    void reset(void);
+
+    uint64 getCount(void) const
+    {
+        return mCount;
+    }
+
+    double getMin(void) const
+    {
+        return mCount != 0 ? mMin : 0.0;
+    }
+
+    double getMax(void) const
+    {
+        return mCount != 0 ? mMax : 0.0;
+    }
+
+    double getMean(void) const
+    {
+        return mCount != 0 ? mSum / mCount : 0.0;
+    }
+
+    uint64 getBucketCount(int bucket) const
+    {
+        return mBuckets[bucket];
+    }
+
+    /**
+     * Gets the exclusive upper bound of the given bucket.
+     */
+    double getBucketUpperBound(int bucket) const;
+
+    /**
+     * Estimates a percentile from the bucket counts. The result is the upper
+     * bound of the bucket the percentile falls in, clamped to the maximum.
+     * @param fraction - percentile in range [0, 1], e.g. 0.99
+     */
+    double getPercentile(double fraction) const;
+
+    /**
+     * Prints the summary and all non-empty buckets through NativeLog().
+     * @param name - name of the histogram shown in the output
+     */
+    void log(char const *name) const;
+
+private:
+    double mUnit;
+    uint64 mBuckets[BucketCount];
+    uint64 mCount;
+    double mSum;
+    double mMin;
+    double mMax;
+};
+
+}
+
+#endif /* HISTOGRAM_H_ */
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#if defined(__linux__) || defined(ANDROID)
+#include <sys/mman.h>
+#include <errno.h>
+#include <atomic>
+#define HUGE_PAGE_MMAP
+#endif
+#include "SystemCore.h"
+#include "HugePageAllocator.h"
+
+#ifdef HUGE_PAGE_MMAP
+
+// number of requests that skip the reserved pool after it ran out
+#define HUGE_TLB_RETRY_INTERVAL 64
+
+// set once the kernel rejected MAP_HUGETLB, so that we don't ask again
+static std::atomic<bool> g_HugeTlbUnsupported(false);
+// requests left before the reserved pool is tried again
+static std::atomic<int> g_HugeTlbBackoff(0);
+
+static bool ShouldTryHugeTlb(void)
+{
+    if (g_HugeTlbUnsupported.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    int backoff = g_HugeTlbBackoff.load(std::memory_order_relaxed);
+    while (backoff > 0)
+    {
+        if (g_HugeTlbBackoff.compare_exchange_weak(backoff, backoff - 1, std::memory_order_relaxed))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void *System::Internal::HugePageMap(size_t size, size_t &mappedSize)
+{
+    size_t const alignedSize = (size + HUGE_PAGE_SIZE - 1) & ~static_cast<size_t>(HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+    if (ShouldTryHugeTlb())
+    {
+        void *ptr = mmap(0, alignedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+            mappedSize = alignedSize;
+            return ptr;
+        }
+
+        if (errno == EINVAL || errno == ENOSYS)
+        {
+            g_HugeTlbUnsupported.store(true, std::memory_order_relaxed);
+            LOG_DEBUG(LOG_MEM, "MAP_HUGETLB not supported, using transparent huge pages");
+        }
+        else
+        {
+            // the pool is exhausted for now, pages may be freed later
+            g_HugeTlbBackoff.store(HUGE_TLB_RETRY_INTERVAL, std::memory_order_relaxed);
+        }
+    }
+#endif
+
+    // over-map and cut off the ends, so that the mapping is huge page aligned
+    size_t const overSize = alignedSize + HUGE_PAGE_SIZE;
+    uchar *base = static_cast<uchar *>(mmap(0, overSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    uchar *ptr = reinterpret_cast<uchar *>((reinterpret_cast<size_t>(base) + HUGE_PAGE_SIZE - 1)
+            & ~static_cast<size_t>(HUGE_PAGE_SIZE - 1));
+    if (ptr != base)
+    {
+        munmap(base, ptr - base);
+    }
+    if (ptr + alignedSize != base + overSize)
+    {
+        munmap(ptr + alignedSize, (base + overSize) - (ptr + alignedSize));
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, alignedSize, MADV_HUGEPAGE);
+#endif
+
+    mappedSize = alignedSize;
+    return ptr;
+}
+
+void System::Internal::HugePageUnmap(void *ptr, size_t mappedSize)
+{
+    munmap(ptr, mappedSize);
+}
+
+#else
+
+void *System::Internal::HugePageMap(size_t size, size_t &mappedSize)
+{
+    (void)size;
+    mappedSize = 0;
+    return 0;
+}
+
+void System::Internal::HugePageUnmap(void *ptr, size_t mappedSize)
+{
+    (void)ptr;
+    (void)mappedSize;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef HUGEPAGEALLOCATOR_H_
+#define HUGEPAGEALLOCATOR_H_
+
+/**
+ * @file
+ * Huge page mappings, used by the MemoryAlloc() backends for requests made
+ * with MEMORY_ALLOC_HUGE_PAGES.
+ *
+ * A mapping is first requested from the reserved huge page pool
+ * (MAP_HUGETLB). When the pool is empty or missing, a regular mapping
+ * aligned to HUGE_PAGE_SIZE is created and marked for transparent huge
+ * pages (MADV_HUGEPAGE), so the kernel backs it by huge pages when it
+ * can. An empty pool is asked again after a number of requests, a kernel
+ * without MAP_HUGETLB support is not asked again. Platforms without mmap
+ * get no mapping and the callers fall back to the regular allocation.
+ */
+
+#include <stddef.h>
+#include "Base.h"
+
+// huge page size on x86-64 and ARM with 4 KB base pages
+#define HUGE_PAGE_SIZE                  (2 * 1024 * 1024)
+// smaller requests are not worth a huge page and ignore MEMORY_ALLOC_HUGE_PAGES
+#define HUGE_PAGE_MIN_ALLOCATION_SIZE   (HUGE_PAGE_SIZE / 2)
+
+namespace System
+{
+
+namespace Internal
+{
+
+/**
+ * Maps memory backed by huge pages if possible.
+ * @param size - requested size in bytes
+ * @param mappedSize - receives the size of the mapping, needed by HugePageUnmap()
+ * @return HUGE_PAGE_SIZE aligned mapping or null if huge pages are not supported
+ */
+void *HugePageMap(size_t size, size_t &mappedSize);
+
+/**
+ * Unmaps memory mapped by HugePageMap().
+ * @param ptr - the mapping
+ * @param mappedSize - size of the mapping
+ */
+void HugePageUnmap(void *ptr, size_t mappedSize);
+
+}
+
+}
+
+#endif /* HUGEPAGEALLOCATOR_H_ */
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _INTRUSIVEQUEUE_H
+#define _INTRUSIVEQUEUE_H
+
+/**
+ * @file
+ * Definition of IntrusiveQueue.
+ */
+
+#include "Base.h"
+
+namespace NVR
+{
+
+/**
+ * Base class for all elements stored in an IntrusiveQueue. The element
+ * carries its own link field, so that enqueueing never allocates.
+ */
+template<typename T> class IntrusiveQueueNode
+{
+public:
+    typedef T* NodePtr;
+
+    IntrusiveQueueNode(void)
+            : mNext(0)
+    {
+    }
+
+    ~IntrusiveQueueNode(void)
+    {
+    }
+
+    FORCE_INLINE NodePtr next(void) const
+    {
+        return mNext;
+    }
+
+    FORCE_INLINE NodePtr &next(void)
+    {
+        return mNext;
+    }
+
+protected:
+    NodePtr mNext;
+
+private:
+    IntrusiveQueueNode(IntrusiveQueueNode const &);
+    IntrusiveQueueNode &operator=(IntrusiveQueueNode const &);
+};
+
+/**
+ * Single-threaded FIFO of intrusive nodes. The queue never owns its
+ * elements: they are usually allocated from a TypedBlockAllocator and
+ * must outlive their stay in the queue.
+ */
+template<typename T> class IntrusiveQueue
+{
+public:
+    typedef typename T::NodePtr NodePtr;
+
+    IntrusiveQueue(void)
+            : mHead(0), mTail(0), mSize(0)
+    {
+    }
+
+    /**
+     * Appends a node to the end of the queue.
+     */
+    void push(NodePtr node)
+    {
+        node->next() = 0;
+        if (mTail != 0)
+        {
+            mTail->next() = node;
+        }
+        else
+        {
+            mHead = node;
+        }
+        mTail = node;
+        mSize++;
+    }
+
+    /**
+     * Moves all nodes of another queue to the end of this queue. The
+     * other queue is left empty.
+     */
+    void pushAll(IntrusiveQueue &queue)
+    {
+        if (queue.mHead == 0)
+        {
+            return;
+        }
+
+        if (mTail != 0)
+        {
+            mTail->next() = queue.mHead;
+        }
+        else
+        {
+            mHead = queue.mHead;
+        }
+        mTail = queue.mTail;
+        mSize += queue.mSize;
+
+        queue.clear();
+    }
+
+    /**
+     * Removes a node from the front of the queue.
+     * @return removed node or null if the queue is empty
+     */
+    NodePtr pop(void)
+    {
+        NodePtr node = mHead;
+        if (node != 0)
+        {
+            mHead = node->next();
+            if (mHead == 0)
+            {
+                mTail = 0;
+            }
+            node->next() = 0;
+            mSize--;
+        }
+
+        return node;
+    }
+
+    NodePtr front(void) const
+    {
+        return mHead;
+    }
+
+    bool empty(void) const
+    {
+        return mHead == 0;
+    }
+
+    int size(void) const
+    {
+        return mSize;
+    }
+
+    /**
+     * Forgets all queued nodes. The nodes themselves are not touched.
+     */
+    void clear(void)
+    {
+        mHead = 0;
+        mTail = 0;
+        mSize = 0;
+    }
+
+    void swap(IntrusiveQueue &queue)
+    {
+        xchg(mHead, queue.mHead);
+        xchg(mTail, queue.mTail);
+        xchg(mSize, queue.mSize);
+    }
+
+private:
+    IntrusiveQueue(IntrusiveQueue const &);
+    IntrusiveQueue &operator=(IntrusiveQueue const &);
+
+    NodePtr mHead;
+    NodePtr mTail;
+    int mSize;
+};
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include "SystemCore.h"
+#include "LinearArena.h"
+
+System::LinearArena::LinearArena(size_t chunkSize)
+        : mChunkSize(chunkSize < CACHELINE_ALIGNMENT ? CACHELINE_ALIGNMENT : chunkSize), mChunks(0), mCursor(0),
+          mEnd(0), mFullChunksUsedSize(0), mCapacity(0), mPeakSize(0)
+{
+    addChunk(mChunkSize);
+}
+
+System::LinearArena::~LinearArena(void)
+{
+    freeChunks();
+}
+
+void System::LinearArena::reset(void)
+{
+    size_t const used = getUsedSize();
+    if (used > mPeakSize)
+    {
+        mPeakSize = used;
+    }
+
+    if (mChunks->next != 0)
+    {
+        // the last run needed several chunks, replace them by a single one
+        size_t const size = (mPeakSize + mChunkSize - 1) / mChunkSize * mChunkSize;
+        freeChunks();
+        addChunk(size);
+    }
+    else
+    {
+        mCursor = GetChunkData(mChunks);
+    }
+
+    mFullChunksUsedSize = 0;
+}
+
+size_t System::LinearArena::getUsedSize(void) const
+{
+    return mFullChunksUsedSize + (mCursor - GetChunkData(mChunks));
+}
+
+void System::LinearArena::addChunk(size_t size)
+{
+    Chunk *chunk = unsafe_pointer_cast<Chunk>(MemoryAlloc<uchar>(CACHELINE_ALIGNMENT + size, CACHELINE_ALIGNMENT));
+    chunk->next = mChunks;
+    chunk->size = size;
+
+    mChunks = chunk;
+    mCursor = GetChunkData(chunk);
+    mEnd = mCursor + size;
+    mCapacity += size;
+}
+
+void System::LinearArena::freeChunks(void)
+{
+    while (mChunks != 0)
+    {
+        Chunk *next = mChunks->next;
+        MemoryFree(mChunks);
+        mChunks = next;
+    }
+
+    mCursor = 0;
+    mEnd = 0;
+    mCapacity = 0;
+}
+
+uchar *System::LinearArena::allocateFromNewChunk(size_t size, size_t alignSize)
+{
+    mFullChunksUsedSize += mCursor - GetChunkData(mChunks);
+
+    // chunk data is cache line aligned, larger alignments need padding
+    size_t const padding = alignSize > CACHELINE_ALIGNMENT ? alignSize - CACHELINE_ALIGNMENT : 0;
+    addChunk(size + padding > mChunkSize ? size + padding : mChunkSize);
+
+    return allocate(size, alignSize);
+}
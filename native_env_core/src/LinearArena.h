@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef LINEARARENA_H_
+#define LINEARARENA_H_
+
+/**
+ * @file
+ * Definition of LinearArena and FrameArena.
+ */
+
+#include <stddef.h>
+#include "Base.h"
+#include "ManagedPtr.h"
+
+namespace System
+{
+
+// default size of the memory chunks of a linear arena
+#define LINEAR_ARENA_CHUNK_SIZE             65536
+// alignment of allocations that do not ask for one
+#define LINEAR_ARENA_DEFAULT_ALIGNMENT      16
+
+/**
+ * Bump allocator for temporaries that die together. allocate() moves a
+ * cursor through a memory chunk, individual allocations are never freed,
+ * reset() releases all of them at once. When a chunk runs out a new one is
+ * chained, and the next reset() merges the chunks into one large enough
+ * for the peak usage, so a steady workload stops touching the heap after
+ * its first frames. Destructors of objects placed in the arena are not
+ * called. The class is not thread-safe, use an arena per thread.
+ */
+class LinearArena: public ManagedAbstractObject
+{
+public:
+    /**
+     * Default constructor.
+     * @param chunkSize - size of the first chunk and the minimal size of chained ones
+     */
+    LinearArena(size_t chunkSize = LINEAR_ARENA_CHUNK_SIZE);
+    ~LinearArena(void);
+
+    /**
+     * Allocates memory valid till the next reset().
+     * @param size - size in bytes
+     * @param alignSize - alignment, power of two
+     * @return pointer to the memory
+     */
+    uchar *allocate(size_t size, size_t alignSize = LINEAR_ARENA_DEFAULT_ALIGNMENT)
+    {
+        uchar *ptr = reinterpret_cast<uchar *>((reinterpret_cast<size_t>(mCursor) + (alignSize - 1)) & ~(alignSize - 1));
+        if (ptr + size <= mEnd)
+        {
+            mCursor = ptr + size;
+            return ptr;
+        }
+
+        return allocateFromNewChunk(size, alignSize);
+    }
+
+    /**
+     * Allocates an uninitialized array valid till the next reset().
+     * @param count - number of elements
+     * @param alignSize - alignment, power of two
+     */
+    template<typename T> T *allocateArray(size_t count, size_t alignSize = LINEAR_ARENA_DEFAULT_ALIGNMENT)
+    {
+        return reinterpret_cast<T *>(allocate(sizeof(T) * count, alignSize));
+    }
+
+    /**
+     * Releases all allocations.
+     */
+    void reset(void);
+
+    /**
+     * Gets the number of bytes allocated since the last reset, including
+     * alignment padding.
+     */
+    size_t getUsedSize(void) const;
+
+    /**
+     * Gets the highest getUsedSize() seen by reset().
+     */
+    size_t getPeakSize(void) const
+    {
+        return mPeakSize;
+    }
+
+    /**
+     * Gets the number of bytes held by the arena.
+     */
+    size_t getCapacity(void) const
+    {
+        return mCapacity;
+    }
+
+private:
+    // prevent copy construction and assignment
+    LinearArena(LinearArena const &instance);
+    LinearArena &operator=(LinearArena const &instance);
+
+    typedef struct ChunkStruct
+    {
+        struct ChunkStruct *next;
+        size_t size;
+    } Chunk;
+
+    static uchar *GetChunkData(Chunk *chunk)
+    {
+        return reinterpret_cast<uchar *>(chunk) + CACHELINE_ALIGNMENT;
+    }
+
+    void addChunk(size_t size);
+    void freeChunks(void);
+    uchar *allocateFromNewChunk(size_t size, size_t alignSize);
+
+    size_t const mChunkSize;
+
+    Chunk *mChunks; // the current one first
+    uchar *mCursor;
+    uchar *mEnd;
+
+    size_t mFullChunksUsedSize; // bytes used in the chunks behind the current one
+    size_t mCapacity;
+    size_t mPeakSize;
+};
+
+/**
+ * Pair of linear arenas for per-frame temporaries. Allocations made during
+ * a frame stay valid through the following frame, so the consumer of a
+ * frame (e.g. the render thread drawing the previous frame's commands)
+ * can still read them while the producer fills the next one. Calling
+ * beginFrame() switches arenas and resets the one allocated from two
+ * frames ago.
+ */
+class FrameArena: public ManagedAbstractObject
+{
+public:
+    /**
+     * Default constructor.
+     * @param chunkSize - chunk size of both arenas
+     */
+    FrameArena(size_t chunkSize = LINEAR_ARENA_CHUNK_SIZE)
+            : mFirstArena(chunkSize), mSecondArena(chunkSize), mCurrent(&mFirstArena), mPrevious(&mSecondArena),
+              mFrameIndex(0)
+    {
+    }
+
+    ~FrameArena(void)
+    {
+    }
+
+    /**
+     * Marks a frame boundary. Releases the allocations made two frames ago.
+     */
+    void beginFrame(void)
+    {
+        LinearArena *tmp = mPrevious;
+        mPrevious = mCurrent;
+        mCurrent = tmp;
+        mCurrent->reset();
+        mFrameIndex++;
+    }
+
+    uchar *allocate(size_t size, size_t alignSize = LINEAR_ARENA_DEFAULT_ALIGNMENT)
+    {
+        return mCurrent->allocate(size, alignSize);
+    }
+
+    template<typename T> T *allocateArray(size_t count, size_t alignSize = LINEAR_ARENA_DEFAULT_ALIGNMENT)
+    {
+        return mCurrent->allocateArray<T>(count, alignSize);
+    }
+
+    /**
+     * Gets the arena of the current frame.
+     */
+    LinearArena &current(void)
+    {
+        return *mCurrent;
+    }
+
+    /**
+     * Gets the arena of the previous frame, its allocations are still valid.
+     */
+    LinearArena &previous(void)
+    {
+        return *mPrevious;
+    }
+
+    /**
+     * Returns the number of beginFrame() calls.
+     */
+    uint64 getFrameIndex(void) const
+    {
+        return mFrameIndex;
+    }
+
+private:
+    // prevent copy construction and assignment
+    FrameArena(FrameArena const &instance);
+    FrameArena &operator=(FrameArena const &instance);
+
+    LinearArena mFirstArena;
+    LinearArena mSecondArena;
+    LinearArena *mCurrent;
+    LinearArena *mPrevious;
+    uint64 mFrameIndex;
+};
+
+}
+
+#endif /* LINEARARENA_H_ */
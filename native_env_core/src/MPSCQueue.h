@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _MPSCQUEUE_H
+#define _MPSCQUEUE_H
+
+/**
+ * @file
+ * Definition of MPSCQueue.
+ */
+
+#include <atomic>
+#include "Base.h"
+
+namespace NVR
+{
+
+template<typename T> class MPSCQueue;
+
+/**
+ * Base class for all elements stored in an MPSCQueue.
+ */
+template<typename T> class MPSCQueueNode
+{
+    friend class MPSCQueue<T>;
+public:
+    MPSCQueueNode(void)
+            : mNext(0)
+    {
+    }
+
+    ~MPSCQueueNode(void)
+    {
+    }
+
+private:
+    MPSCQueueNode(MPSCQueueNode const &);
+    MPSCQueueNode &operator=(MPSCQueueNode const &);
+
+    std::atomic<MPSCQueueNode *> mNext;
+};
+
+/**
+ * Lock-free FIFO of intrusive nodes with any number of producer threads
+ * and a single consumer thread (D. Vyukov's intrusive MPSC queue). push()
+ * is one atomic exchange and never waits for other threads; pop() takes no
+ * lock either. A producer preempted in the middle of push() hides the
+ * nodes pushed after it until it resumes, pop() returns null meanwhile,
+ * so a consumer draining once per frame just picks them up next time.
+ * The queue never owns its elements, see IntrusiveQueue.
+ */
+template<typename T> class MPSCQueue
+{
+    typedef MPSCQueueNode<T> Node;
+public:
+    MPSCQueue(void)
+            : mHead(&mStub), mTail(&mStub)
+    {
+    }
+
+    /**
+     * Appends a node to the end of the queue. Callable from any thread.
+     */
+    void push(T *node)
+    {
+        pushNode(node);
+    }
+
+    /**
+     * Removes a node from the front of the queue. Only the consumer
+     * thread may call it.
+     * @return removed node or null if the queue is empty
+     */
+    T *pop(void)
+    {
+        Node *tail = mTail;
+        Node *next = tail->mNext.load(std::memory_order_acquire);
+
+        if (tail == &mStub)
+        {
+            if (next == 0)
+            {
+                return 0;
+            }
+            mTail = next;
+            tail = next;
+            next = next->mNext.load(std::memory_order_acquire);
+        }
+
+        if (next != 0)
+        {
+            mTail = next;
+            return static_cast<T *>(tail);
+        }
+
+        if (tail != mHead.load(std::memory_order_acquire))
+        {
+            // a producer has not linked its node yet
+            return 0;
+        }
+
+        // tail is the last node, put the stub behind it so it can be taken
+        pushNode(&mStub);
+        next = tail->mNext.load(std::memory_order_acquire);
+        if (next != 0)
+        {
+            mTail = next;
+            return static_cast<T *>(tail);
+        }
+
+        return 0;
+    }
+
+    /**
+     * Returns true if no node is queued. The answer may be stale for
+     * threads other than the consumer.
+     */
+    bool empty(void) const
+    {
+        return mTail == &mStub && mStub.mNext.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    MPSCQueue(MPSCQueue const &);
+    MPSCQueue &operator=(MPSCQueue const &);
+
+    void pushNode(Node *node)
+    {
+        node->mNext.store(0, std::memory_order_relaxed);
+        Node *prev = mHead.exchange(node, std::memory_order_acq_rel);
+        prev->mNext.store(node, std::memory_order_release);
+    }
+
+    // producers and consumer on separate cache lines
+    std::atomic<Node *> mHead;
+    uchar mPadding[CACHELINE_ALIGNMENT - sizeof(std::atomic<Node *>)];
+    Node *mTail;
+    Node mStub;
+};
+
+}
+
+#endif
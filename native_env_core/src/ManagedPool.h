@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef MANAGEDPOOL_H_
+#define MANAGEDPOOL_H_
+
+/**
+ * @file
+ * Pooled allocation of reference counted objects: ManagedRecyclableObject,
+ * System::ManagedPool and make_managed().
+ */
+
+#include <utility>
+#include "Base.h"
+#include "ManagedPtr.h"
+#include "Delegate.h"
+#include "MemAlloc.h"
+#include "ConcurrentBlockAllocator.h"
+
+/**
+ * Base class for reference counted objects that are handed to a recycler
+ * instead of being deleted when their last reference drops, e.g. frame
+ * buffers returned to their pool. Objects without a recycler are deleted
+ * as with ManagedObject. The recycler runs on the thread dropping the last
+ * reference.
+ */
+template<typename T, typename RefCountPolicy = ManagedRefCountPolicy> class ManagedRecyclableObject
+{
+public:
+    typedef NVR::Delegate<void, T *> Recycler;
+
+    ManagedRecyclableObject(void)
+            : mRefCount(0)
+    {
+    }
+
+    ManagedRecyclableObject(ManagedRecyclableObject const &)
+            : mRefCount(0)
+    {
+    }
+
+    ManagedRecyclableObject &operator=(ManagedRecyclableObject const &)
+    {
+        return *this;
+    }
+
+    /**
+     * Sets the function receiving the object when its last reference drops.
+     * It takes over the object, and may keep it constructed for reuse.
+     * @param recycler - recycler, an empty delegate to delete the object
+     */
+    void setRecycler(Recycler const &recycler)
+    {
+        mRecycler = recycler;
+    }
+
+    friend void managed_ptr_acquire(T *ptr)
+    {
+        RefCountPolicy::Increment(ptr->mRefCount);
+    }
+
+    friend void managed_ptr_release(T *ptr)
+    {
+        if (RefCountPolicy::Decrement(ptr->mRefCount))
+        {
+            if (ptr->mRecycler)
+            {
+                ptr->mRecycler(ptr);
+            }
+            else
+            {
+                delete ptr;
+            }
+        }
+    }
+
+private:
+    typename RefCountPolicy::Counter mRefCount;
+    Recycler mRecycler;
+};
+
+namespace System
+{
+
+/**
+ * Pool of reference counted objects. make() constructs an object in a
+ * block of the allocator and sets the pool as its recycler, so the object
+ * is destroyed and its block reused when the last managed_ptr to it is
+ * released. With the default ConcurrentTypedBlockAllocator the last
+ * reference may be dropped on any thread; T should use
+ * ManagedAtomicRefCountPolicy then. The pool has to outlive its objects.
+ *
+ * @param T - a ManagedRecyclableObject
+ * @param Allocator - typed block allocator, TypedBlockAllocator<T> for
+ * objects used by a single thread
+ */
+template<typename T, typename Allocator = ConcurrentTypedBlockAllocator<T> > class ManagedPool
+{
+public:
+    ManagedPool(void)
+    {
+    }
+
+    /**
+     * Constructs an object in the pool.
+     * @param args - constructor arguments
+     */
+    template<typename ... Args> managed_ptr<T> make(Args &&... args)
+    {
+        T *instance = mAllocator.allocate(std::forward<Args>(args)...);
+        instance->setRecycler(T::Recycler::template CreateFromMethod<ManagedPool, &ManagedPool::recycle>(this));
+        return managed_ptr<T>(instance);
+    }
+
+    Allocator &getAllocator(void)
+    {
+        return mAllocator;
+    }
+
+private:
+    // prevent copy construction and assignment
+    ManagedPool(ManagedPool const &instance);
+    ManagedPool &operator=(ManagedPool const &instance);
+
+    void recycle(T *instance)
+    {
+        mAllocator.deallocate(instance);
+    }
+
+    Allocator mAllocator;
+};
+
+}
+
+/**
+ * Constructs a managed object on the heap.
+ * @param args - constructor arguments
+ */
+template<typename T, typename ... Args> inline managed_ptr<T> make_managed(Args &&... args)
+{
+    return managed_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+/**
+ * Constructs a managed object in a pool.
+ * @param pool - pool the object returns to
+ * @param args - constructor arguments
+ */
+template<typename T, typename Allocator, typename ... Args>
+inline managed_ptr<T> make_managed(System::ManagedPool<T, Allocator> &pool, Args &&... args)
+{
+    return pool.make(std::forward<Args>(args)...);
+}
+
+#endif /* MANAGEDPOOL_H_ */
@@ -11,10 +11,101 @@
 #ifndef MANAGEDPTR_H_
 #define MANAGEDPTR_H_
 
+#include <atomic>
+
+/**
+ * Reference count policy for objects used by a single thread at a time.
+ */
+struct ManagedRefCountPolicy
+{
+    typedef int Counter;
+
+    static void Increment(Counter &count)
+    {
+        count++;
+    }
+
+    /**
+     * Returns true if the last reference was dropped.
+     */
+    static bool Decrement(Counter &count)
+    {
+        return --count <= 0;
+    }
+
+    /**
+     * Increments the count unless it is zero, used to lock weak references.
+     * Returns true if it was incremented.
+     */
+    static bool IncrementIfNonZero(Counter &count)
+    {
+        if (count <= 0)
+        {
+            return false;
+        }
+        count++;
+        return true;
+    }
+
+    static int Get(Counter const &count)
+    {
+        return count;
+    }
+};
+
 /**
- * Base class for all objects managed with reference counting
+ * Reference count policy for objects shared between threads, e.g. frames
+ * passed from the capture thread to workers and the render thread. A new
+ * reference is always made from an existing one, so the increment needs
+ * no ordering. The final decrement synchronizes with all earlier ones,
+ * so that writes made through other references happen before the delete.
  */
-template<typename T> class ManagedObject
+struct ManagedAtomicRefCountPolicy
+{
+    typedef std::atomic<int> Counter;
+
+    static void Increment(Counter &count)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool Decrement(Counter &count)
+    {
+        if (count.fetch_sub(1, std::memory_order_release) <= 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+
+    static bool IncrementIfNonZero(Counter &count)
+    {
+        // the count never rises again once it reached zero
+        int current = count.load(std::memory_order_relaxed);
+        while (current > 0)
+        {
+            if (count.compare_exchange_weak(current, current + 1, std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static int Get(Counter const &count)
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Base class for all objects managed with reference counting. The policy
+ * selects plain or atomic counting, e.g.
+ * class Frame: public ManagedObject<Frame, ManagedAtomicRefCountPolicy>
+ */
+template<typename T, typename RefCountPolicy = ManagedRefCountPolicy> class ManagedObject
 {
 public:
     ManagedObject(void)
@@ -22,22 +113,32 @@ public:
     {
     }
 
+    // the count belongs to the instance, copies start without references
+    ManagedObject(ManagedObject const &)
+            : mRefCount(0)
+    {
+    }
+
+    ManagedObject &operator=(ManagedObject const &)
+    {
+        return *this;
+    }
+
     friend void managed_ptr_acquire(T *ptr)
     {
-        ptr->mRefCount++;
+        RefCountPolicy::Increment(ptr->mRefCount);
     }
 
     friend void managed_ptr_release(T *ptr)
     {
-        ptr->mRefCount--;
-        if (ptr->mRefCount <= 0)
+        if (RefCountPolicy::Decrement(ptr->mRefCount))
         {
             delete ptr;
         }
     }
 
 private:
-    int mRefCount;
+    typename RefCountPolicy::Counter mRefCount;
 };
 
 class ManagedAbstractObject
@@ -48,24 +149,73 @@ public:
     {
     }
 
+    ManagedAbstractObject(ManagedAbstractObject const &)
+            : mRefCount(0)
+    {
+    }
+
+    ManagedAbstractObject &operator=(ManagedAbstractObject const &)
+    {
+        return *this;
+    }
+
     virtual ~ManagedAbstractObject(void) = 0;
 
     friend void managed_ptr_acquire(ManagedAbstractObject *ptr)
     {
-        ptr->mRefCount++;
+        ManagedRefCountPolicy::Increment(ptr->mRefCount);
     }
 
     friend void managed_ptr_release(ManagedAbstractObject *ptr)
     {
-        ptr->mRefCount--;
-        if (ptr->mRefCount <= 0)
+        if (ManagedRefCountPolicy::Decrement(ptr->mRefCount))
+        {
+            delete ptr;
+        }
+    }
+
+private:
+    ManagedRefCountPolicy::Counter mRefCount;
+};
+
+/**
+ * ManagedAbstractObject with ManagedAtomicRefCountPolicy.
+ */
+class ManagedAbstractAtomicObject
+{
+public:
+    ManagedAbstractAtomicObject(void)
+            : mRefCount(0)
+    {
+    }
+
+    ManagedAbstractAtomicObject(ManagedAbstractAtomicObject const &)
+            : mRefCount(0)
+    {
+    }
+
+    ManagedAbstractAtomicObject &operator=(ManagedAbstractAtomicObject const &)
+    {
+        return *this;
+    }
+
+    virtual ~ManagedAbstractAtomicObject(void) = 0;
+
+    friend void managed_ptr_acquire(ManagedAbstractAtomicObject *ptr)
+    {
+        ManagedAtomicRefCountPolicy::Increment(ptr->mRefCount);
+    }
+
+    friend void managed_ptr_release(ManagedAbstractAtomicObject *ptr)
+    {
+        if (ManagedAtomicRefCountPolicy::Decrement(ptr->mRefCount))
         {
             delete ptr;
         }
     }
 
 private:
-    int mRefCount;
+    ManagedAtomicRefCountPolicy::Counter mRefCount;
 };
 
 /**
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef MANAGEDWEAKPTR_H_
+#define MANAGEDWEAKPTR_H_
+
+/**
+ * @file
+ * Weak references to managed objects: ManagedWeakObject and managed_weak_ptr.
+ */
+
+#include "ManagedPtr.h"
+
+/**
+ * Reference counts of a ManagedWeakObject. They live in a separate block,
+ * so that weak references can still tell that the object is gone. The
+ * object holds one weak reference itself, the block is freed when the
+ * object and all weak references are gone.
+ */
+template<typename T, typename RefCountPolicy> class ManagedWeakControl
+{
+public:
+    ManagedWeakControl(T *object)
+            : mStrongCount(0), mWeakCount(1), mObject(object)
+    {
+    }
+
+    void acquireStrong(void)
+    {
+        RefCountPolicy::Increment(mStrongCount);
+    }
+
+    /**
+     * Returns true if the last strong reference was dropped.
+     */
+    bool releaseStrong(void)
+    {
+        return RefCountPolicy::Decrement(mStrongCount);
+    }
+
+    /**
+     * Makes a strong reference unless the object is gone or being destroyed.
+     * @return the object or null
+     */
+    T *lock(void)
+    {
+        return RefCountPolicy::IncrementIfNonZero(mStrongCount) ? mObject : 0;
+    }
+
+    bool isExpired(void) const
+    {
+        return RefCountPolicy::Get(mStrongCount) <= 0;
+    }
+
+    void acquireWeak(void)
+    {
+        RefCountPolicy::Increment(mWeakCount);
+    }
+
+    void releaseWeak(void)
+    {
+        if (RefCountPolicy::Decrement(mWeakCount))
+        {
+            delete this;
+        }
+    }
+
+private:
+    // prevent copy construction and assignment
+    ManagedWeakControl(ManagedWeakControl const &instance);
+    ManagedWeakControl &operator=(ManagedWeakControl const &instance);
+
+    typename RefCountPolicy::Counter mStrongCount;
+    typename RefCountPolicy::Counter mWeakCount;
+    T *const mObject;
+};
+
+/**
+ * Base class for reference counted objects that can be referenced weakly,
+ * e.g. entries of asset and texture caches. Construction allocates the
+ * control block, so objects that are never referenced weakly should keep
+ * using ManagedObject. With ManagedAtomicRefCountPolicy weak references
+ * may be locked on any thread.
+ */
+template<typename T, typename RefCountPolicy = ManagedRefCountPolicy> class ManagedWeakObject
+{
+public:
+    typedef ManagedWeakControl<T, RefCountPolicy> WeakControl;
+
+    ManagedWeakObject(void)
+            : mControl(new WeakControl(static_cast<T *>(this)))
+    {
+    }
+
+    ManagedWeakObject(ManagedWeakObject const &)
+            : mControl(new WeakControl(static_cast<T *>(this)))
+    {
+    }
+
+    ManagedWeakObject &operator=(ManagedWeakObject const &)
+    {
+        return *this;
+    }
+
+    ~ManagedWeakObject(void)
+    {
+        mControl->releaseWeak();
+    }
+
+    friend void managed_ptr_acquire(T *ptr)
+    {
+        ptr->mControl->acquireStrong();
+    }
+
+    friend void managed_ptr_release(T *ptr)
+    {
+        if (ptr->mControl->releaseStrong())
+        {
+            delete ptr;
+        }
+    }
+
+    friend WeakControl *managed_ptr_get_weak_control(T *ptr)
+    {
+        return ptr->mControl;
+    }
+
+private:
+    WeakControl *const mControl;
+};
+
+/**
+ * Weak reference to a ManagedWeakObject. It does not keep the object
+ * alive, lock() returns a strong reference if the object still exists.
+ */
+template<typename T> class managed_weak_ptr
+{
+    typedef typename T::WeakControl WeakControl;
+public:
+    managed_weak_ptr(void)
+            : mControl(0)
+    {
+    }
+
+    managed_weak_ptr(managed_ptr<T> const &rhs)
+            : mControl(rhs.get() != 0 ? managed_ptr_get_weak_control(rhs.get()) : 0)
+    {
+        if (mControl != 0)
+        {
+            mControl->acquireWeak();
+        }
+    }
+
+    managed_weak_ptr(managed_weak_ptr const &rhs)
+            : mControl(rhs.mControl)
+    {
+        if (mControl != 0)
+        {
+            mControl->acquireWeak();
+        }
+    }
+
+    managed_weak_ptr(managed_weak_ptr &&rhs)
+            : mControl(rhs.mControl)
+    {
+        rhs.mControl = 0;
+    }
+
+    ~managed_weak_ptr(void)
+    {
+        reset();
+    }
+
+    /**
+     * Gets a strong reference to the object.
+     * @return the object, or an empty pointer if it has been destroyed
+     */
+    managed_ptr<T> lock(void) const
+    {
+        // the reference made by a successful lock() is handed over
+        return managed_ptr<T>(mControl != 0 ? mControl->lock() : 0, false);
+    }
+
+    /**
+     * Returns true if the object has been destroyed. A false result may be
+     * stale by the time it is used, call lock() to use the object.
+     */
+    bool expired(void) const
+    {
+        return mControl == 0 || mControl->isExpired();
+    }
+
+    void reset(void)
+    {
+        if (mControl != 0)
+        {
+            mControl->releaseWeak();
+            mControl = 0;
+        }
+    }
+
+    void swap(managed_weak_ptr &rhs)
+    {
+        WeakControl *tmp = mControl;
+        mControl = rhs.mControl;
+        rhs.mControl = tmp;
+    }
+
+    managed_weak_ptr &operator=(managed_weak_ptr const &rhs)
+    {
+        if (rhs.mControl != 0)
+        {
+            rhs.mControl->acquireWeak();
+        }
+
+        reset();
+        mControl = rhs.mControl;
+
+        return *this;
+    }
+
+    managed_weak_ptr &operator=(managed_weak_ptr &&rhs)
+    {
+        swap(rhs);
+
+        return *this;
+    }
+
+    managed_weak_ptr &operator=(managed_ptr<T> const &rhs)
+    {
+        return *this = managed_weak_ptr(rhs);
+    }
+
+private:
+    WeakControl *mControl;
+};
+
+#endif /* MANAGEDWEAKPTR_H_ */
@@ -16,17 +16,26 @@ ManagedAbstractObject::~ManagedAbstractObject(void)
 {
 }
 
+// default ManagedAbstractAtomicObject destructor
+ManagedAbstractAtomicObject::~ManagedAbstractAtomicObject(void)
+{
+}
+
 // initial number of memory segment slots for fixed size block allocator
 #define FSBA_INITIAL_SEGMENT_NUM 4
 
-System::BlockAllocator::BlockAllocator(uint size, uint capacity)
+System::BlockAllocator::BlockAllocator(uint size, uint capacity, uint maxCapacity, uint allocFlags)
         : mFirstSegmentCapacity(capacity < 1 ? 1 : capacity),
           mBlockSize(size > sizeof(BlockHeader) ? size : sizeof(BlockHeader)),
+          mMaxSegmentCapacity(maxCapacity == 0 ? 0 : (maxCapacity > capacity ? maxCapacity : mFirstSegmentCapacity) * mBlockSize),
+          mAllocFlags(allocFlags),
+          mCategory(GetMemoryCategory() != MemoryCategoryGeneral ? GetMemoryCategory() : MemoryCategoryPool),
           mBlockData(MemoryAlloc<uchar *>(FSBA_INITIAL_SEGMENT_NUM)),
           mSegmentPointerArraySize(FSBA_INITIAL_SEGMENT_NUM), mSegmentCount(1), mCurrentSegmentIndex(0),
-          mCurrentSegmentCapacity(mFirstSegmentCapacity * mBlockSize), mCurrentBlockIndex(0), mFreeRoot(0)
+          mCurrentSegmentCapacity(mFirstSegmentCapacity * mBlockSize), mCurrentBlockIndex(0), mFreeRoot(0),
+          mLiveBlockCount(0), mRetainedSize(0)
 {
-    mBlockData[0] = MemoryAlloc<uchar>(mCurrentSegmentCapacity, CACHELINE_ALIGNMENT);
+    mBlockData[0] = allocateSegment(mCurrentSegmentCapacity);
 }
 
 System::BlockAllocator::~BlockAllocator(void)
@@ -45,8 +54,129 @@ void System::BlockAllocator::deallocateAll(void)
     mCurrentBlockIndex = 0;
     mCurrentSegmentIndex = 0;
     mCurrentSegmentCapacity = mFirstSegmentCapacity * mBlockSize;
+    mLiveBlockCount = 0;
+
+    if (mBlockData[0] == 0)
+    {
+        mBlockData[0] = allocateSegment(mCurrentSegmentCapacity);
+    }
+}
+
+size_t System::BlockAllocator::trim(void)
+{
+    if (mLiveBlockCount == 0)
+    {
+        // nothing to keep, rewind so that only the first segment is needed
+        deallocateAll();
+    }
+
+    // segment sizes follow from their index
+    int *segmentCapacity = MemoryAlloc<int>(mSegmentCount);
+    int *freeBlockCount = MemoryAlloc<int>(mSegmentCount);
+    int capacity = mFirstSegmentCapacity * mBlockSize;
+    for (int i = 0; i < mSegmentCount; i++)
+    {
+        segmentCapacity[i] = capacity;
+        freeBlockCount[i] = 0;
+        capacity = getNextSegmentCapacity(capacity);
+    }
+
+    // count the free blocks of each segment
+    for (BlockHeader *block = mFreeRoot; block != 0; block = block->next)
+    {
+        uchar *ptr = reinterpret_cast<uchar *>(block);
+        for (int i = 0; i < mSegmentCount; i++)
+        {
+            if (ptr >= mBlockData[i] && ptr < mBlockData[i] + segmentCapacity[i])
+            {
+                freeBlockCount[i]++;
+                break;
+            }
+        }
+    }
+
+    // pick the segments where every carved block is free
+    bool anyReleased = false;
+    for (int i = 0; i < mSegmentCount; i++)
+    {
+        int const carvedBlockCount = i < mCurrentSegmentIndex ? segmentCapacity[i] / mBlockSize : 0;
+        if (mBlockData[i] != 0 && i != mCurrentSegmentIndex && freeBlockCount[i] == carvedBlockCount)
+        {
+            // marks the segment as released
+            freeBlockCount[i] = -1;
+            anyReleased = true;
+        }
+    }
+
+    size_t releasedSize = 0;
+    if (anyReleased)
+    {
+        // drop the blocks of released segments from the free list
+        BlockHeader **link = &mFreeRoot;
+        while (*link != 0)
+        {
+            uchar *ptr = reinterpret_cast<uchar *>(*link);
+            bool released = false;
+            for (int i = 0; i < mSegmentCount; i++)
+            {
+                if (ptr >= mBlockData[i] && ptr < mBlockData[i] + segmentCapacity[i])
+                {
+                    released = freeBlockCount[i] < 0;
+                    break;
+                }
+            }
+
+            if (released)
+            {
+                *link = (*link)->next;
+            }
+            else
+            {
+                link = &(*link)->next;
+            }
+        }
+
+        for (int i = 0; i < mSegmentCount; i++)
+        {
+            if (freeBlockCount[i] < 0)
+            {
+                MemoryFree(mBlockData[i]);
+                mBlockData[i] = 0;
+                mRetainedSize -= segmentCapacity[i];
+                releasedSize += segmentCapacity[i];
+            }
+        }
+    }
+
+    MemoryFree(segmentCapacity);
+    MemoryFree(freeBlockCount);
+
+    return releasedSize;
 }
 
+void System::BlockAllocator::getStatistics(BlockAllocatorStatistics &statistics) const
+{
+    statistics.retainedSize = mRetainedSize;
+    statistics.usedSize = static_cast<size_t>(mLiveBlockCount) * mBlockSize;
+    statistics.liveBlockCount = mLiveBlockCount;
+    statistics.segmentCount = 0;
+    for (int i = 0; i < mSegmentCount; i++)
+    {
+        if (mBlockData[i] != 0)
+        {
+            statistics.segmentCount++;
+        }
+    }
+}
+
+uchar *System::BlockAllocator::allocateSegment(int capacity)
+{
+    mRetainedSize += capacity;
+#ifdef MEMORY_TRACKING
+    MemoryCategoryScope scope(mCategory);
+#endif
+    return MemoryAlloc<uchar>(capacity, CACHELINE_ALIGNMENT, mAllocFlags);
+}
 uchar *System::BlockAllocator::allocateNewBlock(void)
 {
     // try to get new block
@@ -66,13 +196,19 @@ uchar *System::BlockAllocator::allocateNewBlock(void)
                 mSegmentPointerArraySize <<= 1;
             }
 
-            mBlockData[mSegmentCount] = MemoryAlloc<uchar>(mCurrentSegmentCapacity << 1, CACHELINE_ALIGNMENT);
+            mBlockData[mSegmentCount] = 0;
             mSegmentCount++;
         }
 
         mCurrentBlockIndex = 0;
         mCurrentSegmentIndex++;
-        mCurrentSegmentCapacity <<= 1;
+        mCurrentSegmentCapacity = getNextSegmentCapacity(mCurrentSegmentCapacity);
+
+        // new or released by trim()
+        if (mBlockData[mCurrentSegmentIndex] == 0)
+        {
+            mBlockData[mCurrentSegmentIndex] = allocateSegment(mCurrentSegmentCapacity);
+        }
     }
 
     uchar *ptr = mBlockData[mCurrentSegmentIndex] + mCurrentBlockIndex;
@@ -11,7 +11,12 @@
 #ifndef MEMALLOC_H_
 #define MEMALLOC_H_
 
+#include <new>
+#include <stddef.h>
+#include <utility>
 #include "Base.h"
+#include "SystemCore.h"
+#include "MemoryTracker.h"
 #include "ManagedPtr.h"
 
 namespace System
@@ -20,6 +25,17 @@ namespace System
 // initial block capacity for fixed size block allocator
 #define BLOCK_ALLOCATOR_MIN_CAPACITY        16
 
+/**
+ * Memory usage of a BlockAllocator.
+ */
+struct BlockAllocatorStatistics
+{
+    size_t retainedSize;  // bytes held in segments
+    size_t usedSize;      // bytes in live blocks
+    int liveBlockCount;
+    int segmentCount;     // segments currently held
+};
+
 class BlockAllocator: public ManagedAbstractObject
 {
     typedef struct BlockHeaderStruct
@@ -27,11 +43,27 @@ class BlockAllocator: public ManagedAbstractObject
         struct BlockHeaderStruct *next;
     } BlockHeader;
 public:
-    BlockAllocator(uint blockSize, uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY);
+    /**
+     * Default constructor.
+     * @param blockSize - size of one block in bytes
+     * @param initialCapacity - number of blocks in the first segment
+     * @param maxSegmentCapacity - if not zero, segments stop doubling at this
+     * number of blocks. Smaller segments are more likely to become entirely
+     * free, so trim() can release more memory after a burst.
+     * @param allocFlags - MemoryAlloc() flags used for the segments, e.g.
+     * MEMORY_ALLOC_HUGE_PAGES for pools with large segments
+     *
+     * Segments are charged to the memory category current at construction,
+     * MemoryCategoryPool if that is MemoryCategoryGeneral.
+     */
+    BlockAllocator(uint blockSize, uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY, uint maxSegmentCapacity = 0,
+            uint allocFlags = MEMORY_ALLOC_DEFAULT);
     ~BlockAllocator(void);
 
     uchar *allocate(void)
     {
+        mLiveBlockCount++;
+
         // can we reuse already allocated block?
         if (mFreeRoot != 0)
         {
@@ -48,11 +80,15 @@ public:
         BlockHeader *header = unsafe_pointer_cast<BlockHeader>(ptr);
         header->next = mFreeRoot;
         mFreeRoot = header;
+        mLiveBlockCount--;
     }
 
+    /**
+     * Gets the number of blocks that fit into the segments held.
+     */
     int getCapacity(void) const
     {
-        return ((1 << mSegmentCount) - 1) * mFirstSegmentCapacity;
+        return static_cast<int>(mRetainedSize / mBlockSize);
     }
 
     int getBlockSize(void) const
@@ -62,17 +98,35 @@ public:
 
     void deallocateAll(void);
 
+    /**
+     * Releases the segments that hold no live block. The free list is
+     * rebuilt without the blocks of released segments.
+     * @return number of bytes released
+     */
+    size_t trim(void);
+
+    void getStatistics(BlockAllocatorStatistics &statistics) const;
+
 private:
     // prevent copy construction and assignment
     BlockAllocator(BlockAllocator const &instance);
     BlockAllocator &operator=(BlockAllocator const &instance);
 
     uchar *allocateNewBlock(void);
+    uchar *allocateSegment(int capacity);
+
+    int getNextSegmentCapacity(int capacity) const
+    {
+        return (mMaxSegmentCapacity != 0 && capacity << 1 > mMaxSegmentCapacity) ? mMaxSegmentCapacity : capacity << 1;
+    }
 
     const int mFirstSegmentCapacity;
     const int mBlockSize;
+    const int mMaxSegmentCapacity; // in bytes, zero if unbounded
+    const uint mAllocFlags;
+    const MemoryCategory mCategory; // segments are charged to it
 
-    uchar **mBlockData;
+    uchar **mBlockData; // released segments are null
     int mSegmentPointerArraySize;
     int mSegmentCount;
     int mCurrentSegmentIndex;
@@ -80,22 +134,26 @@ private:
     int mCurrentBlockIndex;
 
     BlockHeader *mFreeRoot;
+
+    int mLiveBlockCount;
+    size_t mRetainedSize;
 };
 
 template<typename T> class TypedBlockAllocator: protected BlockAllocator
 {
 public:
-    TypedBlockAllocator(uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY)
-            : BlockAllocator(sizeof(T), initialCapacity)
+    TypedBlockAllocator(uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY, uint maxSegmentCapacity = 0,
+            uint allocFlags = MEMORY_ALLOC_DEFAULT)
+            : BlockAllocator(sizeof(T), initialCapacity, maxSegmentCapacity, allocFlags)
     {
     }
 
-    T *allocate(void)
+    template<typename ... Args> T *allocate(Args &&... args)
     {
         // allocate
         T *instance = reinterpret_cast<T *>(BlockAllocator::allocate());
-        // construct instance
-        new (static_cast<void *>(instance)) T();
+        // construct instance from the arguments
+        new (static_cast<void *>(instance)) T(std::forward<Args>(args)...);
         return instance;
     }
 
@@ -117,6 +175,16 @@ public:
         BlockAllocator::deallocateAll();
     }
 
+    size_t trim(void)
+    {
+        return BlockAllocator::trim();
+    }
+
+    void getStatistics(BlockAllocatorStatistics &statistics) const
+    {
+        BlockAllocator::getStatistics(statistics);
+    }
+
 private:
     // prevent copy construction and assignment
     TypedBlockAllocator(TypedBlockAllocator const &instance);
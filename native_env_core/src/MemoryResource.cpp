@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include "SystemCore.h"
+#include "MemoryResource.h"
+
+static_assert(POOL_MEMORY_RESOURCE_MIN_BLOCK_SIZE << (POOL_MEMORY_RESOURCE_POOL_COUNT - 1)
+        == POOL_MEMORY_RESOURCE_MAX_BLOCK_SIZE, "POOL_MEMORY_RESOURCE_POOL_COUNT does not match the block sizes");
+
+namespace
+{
+
+class DefaultMemoryResource: public System::MemoryResource
+{
+public:
+    void *allocate(size_t size, size_t alignSize)
+    {
+        return System::Internal::MemoryAlloc(size, alignSize);
+    }
+
+    void deallocate(void *ptr, size_t size, size_t alignSize)
+    {
+        (void)size;
+        (void)alignSize;
+        System::MemoryFree(ptr);
+    }
+};
+
+// no state, constructing it early or late does not matter
+DefaultMemoryResource g_DefaultMemoryResource;
+
+}
+
+System::MemoryResource *System::GetDefaultMemoryResource(void)
+{
+    return &g_DefaultMemoryResource;
+}
+
+System::PoolMemoryResource::PoolMemoryResource(uint initialCapacity, MemoryResource *upstream)
+        : mUpstream(upstream != 0 ? upstream : GetDefaultMemoryResource())
+{
+    for (int i = 0; i < POOL_MEMORY_RESOURCE_POOL_COUNT; i++)
+    {
+        mPools[i] = new BlockAllocator(POOL_MEMORY_RESOURCE_MIN_BLOCK_SIZE << i, initialCapacity);
+    }
+}
+
+System::PoolMemoryResource::~PoolMemoryResource(void)
+{
+    for (int i = 0; i < POOL_MEMORY_RESOURCE_POOL_COUNT; i++)
+    {
+        delete mPools[i];
+    }
+}
+
+int System::PoolMemoryResource::GetPoolIndex(size_t size, size_t alignSize)
+{
+    size_t blockSize = size > alignSize ? size : alignSize;
+    if (blockSize > POOL_MEMORY_RESOURCE_MAX_BLOCK_SIZE || alignSize > CACHELINE_ALIGNMENT)
+    {
+        return -1;
+    }
+
+    // segments are cache line aligned, so power of two blocks are aligned to their size
+    int index = 0;
+    while ((static_cast<size_t>(POOL_MEMORY_RESOURCE_MIN_BLOCK_SIZE) << index) < blockSize)
+    {
+        index++;
+    }
+
+    return index;
+}
+
+void *System::PoolMemoryResource::allocate(size_t size, size_t alignSize)
+{
+    int const index = GetPoolIndex(size, alignSize);
+    if (index < 0)
+    {
+        return mUpstream->allocate(size, alignSize);
+    }
+
+    return mPools[index]->allocate();
+}
+
+void System::PoolMemoryResource::deallocate(void *ptr, size_t size, size_t alignSize)
+{
+    int const index = GetPoolIndex(size, alignSize);
+    if (index < 0)
+    {
+        mUpstream->deallocate(ptr, size, alignSize);
+        return;
+    }
+
+    mPools[index]->deallocate(static_cast<uchar *>(ptr));
+}
+
+size_t System::PoolMemoryResource::trim(void)
+{
+    size_t released = 0;
+    for (int i = 0; i < POOL_MEMORY_RESOURCE_POOL_COUNT; i++)
+    {
+        released += mPools[i]->trim();
+    }
+
+    return released;
+}
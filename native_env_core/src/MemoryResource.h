@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef MEMORYRESOURCE_H_
+#define MEMORYRESOURCE_H_
+
+/**
+ * @file
+ * Definition of MemoryResource and its heap, arena and pool implementations.
+ */
+
+#include <stddef.h>
+#include "Base.h"
+#include "MemAlloc.h"
+#include "LinearArena.h"
+
+namespace System
+{
+
+// smallest and largest block size of a PoolMemoryResource, powers of two
+#define POOL_MEMORY_RESOURCE_MIN_BLOCK_SIZE     16
+#define POOL_MEMORY_RESOURCE_MAX_BLOCK_SIZE     1024
+#define POOL_MEMORY_RESOURCE_POOL_COUNT         7
+
+/**
+ * Source of memory for ResourceStlAllocator. Unlike MemoryFree(),
+ * deallocate() gets the size and alignment of the allocation back, so
+ * resources do not need per-allocation headers.
+ */
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource(void)
+    {
+    }
+
+    /**
+     * Allocates memory.
+     * @param size - size in bytes
+     * @param alignSize - alignment, power of two
+     * @return pointer to the memory or null if out of memory
+     */
+    virtual void *allocate(size_t size, size_t alignSize) = 0;
+
+    /**
+     * Releases memory.
+     * @param ptr - pointer returned by allocate()
+     * @param size - size passed to allocate()
+     * @param alignSize - alignment passed to allocate()
+     */
+    virtual void deallocate(void *ptr, size_t size, size_t alignSize) = 0;
+};
+
+/**
+ * Gets the resource forwarding to MemoryAlloc() and MemoryFree(). It is
+ * stateless and shared by all threads.
+ */
+MemoryResource *GetDefaultMemoryResource(void);
+
+/**
+ * Resource drawing from a LinearArena. deallocate() does nothing, the
+ * memory is released by the arena reset.
+ */
+class ArenaMemoryResource: public MemoryResource
+{
+public:
+    ArenaMemoryResource(LinearArena &arena)
+            : mArena(arena)
+    {
+    }
+
+    void *allocate(size_t size, size_t alignSize)
+    {
+        return mArena.allocate(size, alignSize);
+    }
+
+    void deallocate(void *ptr, size_t size, size_t alignSize)
+    {
+        (void)ptr;
+        (void)size;
+        (void)alignSize;
+    }
+
+    LinearArena &getArena(void) const
+    {
+        return mArena;
+    }
+
+private:
+    // prevent copy construction and assignment
+    ArenaMemoryResource(ArenaMemoryResource const &instance);
+    ArenaMemoryResource &operator=(ArenaMemoryResource const &instance);
+
+    LinearArena &mArena;
+};
+
+/**
+ * Resource serving small allocations from block allocators, one per power
+ * of two from POOL_MEMORY_RESOURCE_MIN_BLOCK_SIZE to
+ * POOL_MEMORY_RESOURCE_MAX_BLOCK_SIZE. Blocks are aligned to their size up
+ * to CACHELINE_ALIGNMENT. Larger or more aligned requests go to the
+ * upstream resource. Suits node based containers such as std::map and
+ * std::list, whose nodes all have the same size. The class is not
+ * thread-safe, as BlockAllocator.
+ */
+class PoolMemoryResource: public MemoryResource
+{
+public:
+    /**
+     * Default constructor.
+     * @param initialCapacity - number of blocks in the first segment of each pool
+     * @param upstream - resource of the requests the pools do not serve,
+     * the default resource if null
+     */
+    PoolMemoryResource(uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY, MemoryResource *upstream = 0);
+    ~PoolMemoryResource(void);
+
+    void *allocate(size_t size, size_t alignSize);
+    void deallocate(void *ptr, size_t size, size_t alignSize);
+
+    /**
+     * Releases the pool segments that hold no live block.
+     * @return number of bytes released
+     */
+    size_t trim(void);
+
+private:
+    // prevent copy construction and assignment
+    PoolMemoryResource(PoolMemoryResource const &instance);
+    PoolMemoryResource &operator=(PoolMemoryResource const &instance);
+
+    /**
+     * Gets the index of the pool serving a request, -1 if none does.
+     */
+    static int GetPoolIndex(size_t size, size_t alignSize);
+
+    BlockAllocator *mPools[POOL_MEMORY_RESOURCE_POOL_COUNT];
+    MemoryResource *const mUpstream;
+};
+
+}
+
+#endif /* MEMORYRESOURCE_H_ */
@@ -0,0 +1,522 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <atomic>
+#include "SystemCore.h"
+#include "SystemTimer.h"
+#include "MemoryTracker.h"
+
+static char const *const g_MemoryCategoryNames[System::MemoryCategoryCount] =
+{ "general", "pool", "container", "string", "image", "file", "graphics", "app0", "app1", "app2", "app3" };
+
+// current category of each thread
+static THREAD_LOCAL int g_MemoryCategory = System::MemoryCategoryGeneral;
+
+System::MemoryCategory System::GetMemoryCategory(void)
+{
+    return static_cast<MemoryCategory>(g_MemoryCategory);
+}
+
+void System::SetMemoryCategory(MemoryCategory category)
+{
+    g_MemoryCategory = category;
+}
+
+char const *System::GetMemoryCategoryName(MemoryCategory category)
+{
+    return g_MemoryCategoryNames[category];
+}
+
+#ifdef MEMORY_TRACKING
+
+namespace
+{
+
+typedef struct AllocationHeaderStruct
+{
+    size_t size;
+    uint offset; // from the start of the backend allocation
+    ushort category;
+    ushort callSite;
+} AllocationHeader;
+
+// Counters are only written by the owning thread, with a plain load and
+// store, and read by GetMemorySnapshot(). Blocks freed on another thread
+// are subtracted from the counters of that thread, so the live counters
+// of one thread may wrap around, only their sum is meaningful.
+struct CategoryCounters
+{
+    std::atomic<size_t> liveSize;
+    std::atomic<size_t> liveCount;
+    std::atomic<size_t> allocationCount;
+    std::atomic<size_t> allocatedSize;
+};
+
+struct CallSiteCounters
+{
+    std::atomic<size_t> liveSize;
+    std::atomic<size_t> allocationCount;
+};
+
+struct ThreadCounters
+{
+    CategoryCounters categories[System::MemoryCategoryCount];
+    CallSiteCounters callSites[MEMORY_TRACKER_CALL_SITE_COUNT];
+    // live size change not yet added to g_SharedLiveSize, owner thread only
+    ptrdiff_t unsharedSize[System::MemoryCategoryCount];
+    ThreadCounters *prev;
+    ThreadCounters *next;
+};
+
+System::Timer g_SnapshotTimer;
+
+// zero initialized, so that allocations made by static constructors are counted
+std::atomic<size_t> g_CallSiteAddresses[MEMORY_TRACKER_CALL_SITE_COUNT];
+
+THREAD_LOCAL ThreadCounters *g_ThreadCounters = 0;
+
+// registered threads and counters of exited threads, guarded by
+// g_ThreadCountersLock
+pthread_mutex_t g_ThreadCountersLock = PTHREAD_MUTEX_INITIALIZER;
+ThreadCounters *g_ThreadCountersList = 0;
+size_t g_ExitedCategoryCounters[System::MemoryCategoryCount][4];
+size_t g_ExitedCallSiteCounters[MEMORY_TRACKER_CALL_SITE_COUNT][2];
+
+// live size of each category, behind by less than
+// MEMORY_TRACKER_PEAK_GRANULARITY per thread, and its peak
+std::atomic<size_t> g_SharedLiveSize[System::MemoryCategoryCount];
+std::atomic<size_t> g_PeakSize[System::MemoryCategoryCount];
+
+// trace file written by StartMemoryTrace(), records are written under the lock
+std::atomic<FILE *> g_MemoryTraceFile(0);
+pthread_mutex_t g_MemoryTraceLock = PTHREAD_MUTEX_INITIALIZER;
+
+// destroys the counters of exiting threads
+pthread_key_t g_ThreadCountersKey;
+pthread_once_t g_ThreadCountersKeyOnce = PTHREAD_ONCE_INIT;
+
+FORCE_INLINE void AddToCounter(std::atomic<size_t> &counter, size_t value)
+{
+    // single writer, no read-modify-write needed
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+FORCE_INLINE size_t ReadCounter(std::atomic<size_t> const &counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+void UpdatePeakSize(int category, size_t liveSize)
+{
+    size_t peak = g_PeakSize[category].load(std::memory_order_relaxed);
+    while (peak < liveSize
+            && !g_PeakSize[category].compare_exchange_weak(peak, liveSize, std::memory_order_relaxed))
+    {
+    }
+}
+
+NO_INLINE void ShareLiveSize(ThreadCounters &thread, int category)
+{
+    ptrdiff_t const size = thread.unsharedSize[category];
+    thread.unsharedSize[category] = 0;
+
+    size_t const liveSize = g_SharedLiveSize[category].fetch_add(size, std::memory_order_relaxed) + size;
+    if (size > 0)
+    {
+        UpdatePeakSize(category, liveSize);
+    }
+}
+
+FORCE_INLINE void AddToLiveSize(ThreadCounters &thread, int category, ptrdiff_t size)
+{
+    ptrdiff_t const unsharedSize = thread.unsharedSize[category] + size;
+    thread.unsharedSize[category] = unsharedSize;
+    if (unsharedSize >= MEMORY_TRACKER_PEAK_GRANULARITY || unsharedSize <= -MEMORY_TRACKER_PEAK_GRANULARITY)
+    {
+        ShareLiveSize(thread, category);
+    }
+}
+
+void DestroyThreadCounters(void *ptr)
+{
+    ThreadCounters *counters = static_cast<ThreadCounters *>(ptr);
+
+    for (int i = 0; i < System::MemoryCategoryCount; i++)
+    {
+        ShareLiveSize(*counters, i);
+    }
+
+    pthread_mutex_lock(&g_ThreadCountersLock);
+    for (int i = 0; i < System::MemoryCategoryCount; i++)
+    {
+        CategoryCounters const &category = counters->categories[i];
+        g_ExitedCategoryCounters[i][0] += ReadCounter(category.liveSize);
+        g_ExitedCategoryCounters[i][1] += ReadCounter(category.liveCount);
+        g_ExitedCategoryCounters[i][2] += ReadCounter(category.allocationCount);
+        g_ExitedCategoryCounters[i][3] += ReadCounter(category.allocatedSize);
+    }
+    for (int i = 0; i < MEMORY_TRACKER_CALL_SITE_COUNT; i++)
+    {
+        g_ExitedCallSiteCounters[i][0] += ReadCounter(counters->callSites[i].liveSize);
+        g_ExitedCallSiteCounters[i][1] += ReadCounter(counters->callSites[i].allocationCount);
+    }
+
+    if (counters->prev != 0)
+    {
+        counters->prev->next = counters->next;
+    }
+    else
+    {
+        g_ThreadCountersList = counters->next;
+    }
+    if (counters->next != 0)
+    {
+        counters->next->prev = counters->prev;
+    }
+    pthread_mutex_unlock(&g_ThreadCountersLock);
+
+    // frees made by later thread-exit handlers register the thread again
+    g_ThreadCounters = 0;
+    System::Internal::HeapMemoryFree(counters);
+}
+
+void CreateThreadCountersKey(void)
+{
+    pthread_key_create(&g_ThreadCountersKey, &DestroyThreadCounters);
+}
+
+NO_INLINE ThreadCounters *CreateThreadCounters(void)
+{
+    // from the backend, so that the counters do not count themselves
+    size_t const size = ALIGNED_SIZE(sizeof(ThreadCounters), CACHELINE_ALIGNMENT);
+    ThreadCounters *counters =
+            static_cast<ThreadCounters *>(System::Internal::HeapMemoryAlloc(size, CACHELINE_ALIGNMENT));
+    System::MemorySet(counters, 0, size);
+
+    pthread_mutex_lock(&g_ThreadCountersLock);
+    counters->next = g_ThreadCountersList;
+    if (g_ThreadCountersList != 0)
+    {
+        g_ThreadCountersList->prev = counters;
+    }
+    g_ThreadCountersList = counters;
+    pthread_mutex_unlock(&g_ThreadCountersLock);
+
+    pthread_once(&g_ThreadCountersKeyOnce, &CreateThreadCountersKey);
+    pthread_setspecific(g_ThreadCountersKey, counters);
+
+    g_ThreadCounters = counters;
+    return counters;
+}
+
+FORCE_INLINE ThreadCounters &GetThreadCounters(void)
+{
+    ThreadCounters *counters = g_ThreadCounters;
+    return counters != 0 ? *counters : *CreateThreadCounters();
+}
+
+NO_INLINE void TraceMemoryOperation(void const *ptr, size_t size, size_t alignSize)
+{
+    System::MemoryTraceRecord record;
+    record.address = reinterpret_cast<size_t>(ptr);
+    record.size = static_cast<uint>(size);
+    record.alignSize = static_cast<uint>(alignSize);
+
+    pthread_mutex_lock(&g_MemoryTraceLock);
+    FILE *file = g_MemoryTraceFile.load(std::memory_order_relaxed);
+    if (file != 0)
+    {
+        fwrite(&record, sizeof(record), 1, file);
+    }
+    pthread_mutex_unlock(&g_MemoryTraceLock);
+}
+
+int FindCallSite(void const *callSite)
+{
+    size_t const address = reinterpret_cast<size_t>(callSite);
+
+    // short linear probe, slot 0 takes what does not fit
+    uint const hash = static_cast<uint>(address ^ (address >> 13)) * 2654435761u;
+    for (int probe = 0; probe < 8; probe++)
+    {
+        int const slot = 1 + (hash + probe) % (MEMORY_TRACKER_CALL_SITE_COUNT - 1);
+        size_t current = g_CallSiteAddresses[slot].load(std::memory_order_relaxed);
+        if (current == address)
+        {
+            return slot;
+        }
+        if (current == 0 && g_CallSiteAddresses[slot].compare_exchange_strong(current, address))
+        {
+            return slot;
+        }
+        if (current == address)
+        {
+            // claimed by another thread in the meantime
+            return slot;
+        }
+    }
+
+    return 0;
+}
+
+}
+
+// bytes in front of the block have to hold the header
+static_assert(sizeof(AllocationHeader) <= MEMORY_TRACKING_HEADER_SIZE, "MEMORY_TRACKING_HEADER_SIZE too small");
+
+void System::Internal::TrackAllocation(void *ptr, size_t size, size_t offset, MemoryCategory category,
+                                       void const *callSite)
+{
+    int const slot = FindCallSite(callSite);
+
+    AllocationHeader *header = reinterpret_cast<AllocationHeader *>(ptr) - 1;
+    header->size = size;
+    header->offset = static_cast<uint>(offset);
+    header->category = static_cast<ushort>(category);
+    header->callSite = static_cast<ushort>(slot);
+
+    ThreadCounters &thread = GetThreadCounters();
+    CategoryCounters &counters = thread.categories[category];
+    AddToCounter(counters.liveSize, size);
+    AddToCounter(counters.liveCount, 1);
+    AddToCounter(counters.allocationCount, 1);
+    AddToCounter(counters.allocatedSize, size);
+    AddToLiveSize(thread, category, size);
+
+    AddToCounter(thread.callSites[slot].liveSize, size);
+    AddToCounter(thread.callSites[slot].allocationCount, 1);
+
+    if (g_MemoryTraceFile.load(std::memory_order_relaxed) != 0)
+    {
+        TraceMemoryOperation(ptr, size, offset);
+    }
+}
+
+void System::Internal::TrackFree(void *ptr, size_t &offset)
+{
+    AllocationHeader const *header = reinterpret_cast<AllocationHeader const *>(ptr) - 1;
+    offset = header->offset;
+
+    // wraps around if the block was allocated by another thread
+    ThreadCounters &thread = GetThreadCounters();
+    CategoryCounters &counters = thread.categories[header->category];
+    AddToCounter(counters.liveSize, -header->size);
+    AddToCounter(counters.liveCount, static_cast<size_t>(-1));
+    AddToLiveSize(thread, header->category, -static_cast<ptrdiff_t>(header->size));
+
+    AddToCounter(thread.callSites[header->callSite].liveSize, -header->size);
+
+    if (g_MemoryTraceFile.load(std::memory_order_relaxed) != 0)
+    {
+        TraceMemoryOperation(ptr, 0, 0);
+    }
+}
+
+bool System::IsMemoryTrackingEnabled(void)
+{
+    return true;
+}
+
+bool System::StartMemoryTrace(char const *fileName)
+{
+    pthread_mutex_lock(&g_MemoryTraceLock);
+    if (g_MemoryTraceFile.load(std::memory_order_relaxed) != 0)
+    {
+        pthread_mutex_unlock(&g_MemoryTraceLock);
+        return false;
+    }
+
+    FILE *file = fopen(fileName, "wb");
+    if (file != 0)
+    {
+        MemoryTraceHeader header;
+        header.magic = MEMORY_TRACE_MAGIC;
+        header.version = MEMORY_TRACE_VERSION;
+        fwrite(&header, sizeof(header), 1, file);
+
+        g_MemoryTraceFile.store(file, std::memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&g_MemoryTraceLock);
+
+    return file != 0;
+}
+
+void System::StopMemoryTrace(void)
+{
+    pthread_mutex_lock(&g_MemoryTraceLock);
+    FILE *file = g_MemoryTraceFile.exchange(0, std::memory_order_relaxed);
+    if (file != 0)
+    {
+        fclose(file);
+    }
+    pthread_mutex_unlock(&g_MemoryTraceLock);
+}
+
+void System::GetMemorySnapshot(MemorySnapshot &snapshot)
+{
+    // call site counters summed over all threads
+    static MemoryCallSiteStatistics callSites[MEMORY_TRACKER_CALL_SITE_COUNT];
+
+    snapshot.time = g_SnapshotTimer.get();
+
+    pthread_mutex_lock(&g_ThreadCountersLock);
+
+    for (int i = 0; i < MemoryCategoryCount; i++)
+    {
+        MemoryCategoryStatistics &statistics = snapshot.categories[i];
+        statistics.liveSize = g_ExitedCategoryCounters[i][0];
+        statistics.liveCount = g_ExitedCategoryCounters[i][1];
+        statistics.allocationCount = g_ExitedCategoryCounters[i][2];
+        statistics.allocatedSize = g_ExitedCategoryCounters[i][3];
+    }
+    for (int i = 0; i < MEMORY_TRACKER_CALL_SITE_COUNT; i++)
+    {
+        callSites[i].address = reinterpret_cast<void const *>(g_CallSiteAddresses[i].load(std::memory_order_relaxed));
+        callSites[i].liveSize = g_ExitedCallSiteCounters[i][0];
+        callSites[i].allocationCount = g_ExitedCallSiteCounters[i][1];
+    }
+
+    for (ThreadCounters const *thread = g_ThreadCountersList; thread != 0; thread = thread->next)
+    {
+        for (int i = 0; i < MemoryCategoryCount; i++)
+        {
+            CategoryCounters const &counters = thread->categories[i];
+            MemoryCategoryStatistics &statistics = snapshot.categories[i];
+            statistics.liveSize += ReadCounter(counters.liveSize);
+            statistics.liveCount += ReadCounter(counters.liveCount);
+            statistics.allocationCount += ReadCounter(counters.allocationCount);
+            statistics.allocatedSize += ReadCounter(counters.allocatedSize);
+        }
+        for (int i = 0; i < MEMORY_TRACKER_CALL_SITE_COUNT; i++)
+        {
+            callSites[i].liveSize += ReadCounter(thread->callSites[i].liveSize);
+            callSites[i].allocationCount += ReadCounter(thread->callSites[i].allocationCount);
+        }
+    }
+
+    for (int i = 0; i < MemoryCategoryCount; i++)
+    {
+        // the summed counters are exact, they can be above the shared peak
+        MemoryCategoryStatistics &statistics = snapshot.categories[i];
+        UpdatePeakSize(i, statistics.liveSize);
+        statistics.peakSize = g_PeakSize[i].load(std::memory_order_relaxed);
+    }
+
+    // keep the call sites with the most live bytes, insertion sorted
+    snapshot.callSiteCount = 0;
+    for (int i = 0; i < MEMORY_TRACKER_CALL_SITE_COUNT; i++)
+    {
+        MemoryCallSiteStatistics const &site = callSites[i];
+        if (site.allocationCount == 0)
+        {
+            continue;
+        }
+
+        int position = snapshot.callSiteCount;
+        while (position > 0 && snapshot.topCallSites[position - 1].liveSize < site.liveSize)
+        {
+            if (position < MEMORY_SNAPSHOT_CALL_SITE_COUNT)
+            {
+                snapshot.topCallSites[position] = snapshot.topCallSites[position - 1];
+            }
+            position--;
+        }
+
+        if (position < MEMORY_SNAPSHOT_CALL_SITE_COUNT)
+        {
+            snapshot.topCallSites[position] = site;
+            if (snapshot.callSiteCount < MEMORY_SNAPSHOT_CALL_SITE_COUNT)
+            {
+                snapshot.callSiteCount++;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&g_ThreadCountersLock);
+}
+
+#else
+
+void System::Internal::TrackAllocation(void *ptr, size_t size, size_t offset, MemoryCategory category,
+                                       void const *callSite)
+{
+    (void)ptr;
+    (void)size;
+    (void)offset;
+    (void)category;
+    (void)callSite;
+}
+
+void System::Internal::TrackFree(void *ptr, size_t &offset)
+{
+    (void)ptr;
+    offset = 0;
+}
+
+bool System::IsMemoryTrackingEnabled(void)
+{
+    return false;
+}
+
+bool System::StartMemoryTrace(char const *fileName)
+{
+    (void)fileName;
+    return false;
+}
+
+void System::StopMemoryTrace(void)
+{
+}
+
+void System::GetMemorySnapshot(MemorySnapshot &snapshot)
+{
+    MemorySet(&snapshot, 0, sizeof(snapshot));
+}
+
+#endif
+
+void System::LogMemorySnapshot(MemorySnapshot const &snapshot, MemorySnapshot const *previous)
+{
+    if (!IsMemoryTrackingEnabled())
+    {
+        LOG_DEBUG(LOG_MEM, "memory tracking is disabled");
+        return;
+    }
+
+    double const seconds = previous != 0 ? (snapshot.time - previous->time) * 0.001 : 0.0;
+
+    for (int i = 0; i < MemoryCategoryCount; i++)
+    {
+        MemoryCategoryStatistics const &statistics = snapshot.categories[i];
+        if (statistics.allocationCount == 0)
+        {
+            continue;
+        }
+
+        double rate = 0.0;
+        if (seconds > 0.0)
+        {
+            rate = (statistics.allocationCount - previous->categories[i].allocationCount) / seconds;
+        }
+
+        LOG_DEBUG(LOG_MEM, "%-10s live %10.1f KB in %8u blocks, peak %10.1f KB, %.0f allocs/s",
+                  g_MemoryCategoryNames[i], statistics.liveSize / 1024.0, static_cast<uint>(statistics.liveCount),
+                  statistics.peakSize / 1024.0, rate);
+    }
+
+    for (int i = 0; i < snapshot.callSiteCount; i++)
+    {
+        MemoryCallSiteStatistics const &site = snapshot.topCallSites[i];
+        LOG_DEBUG(LOG_MEM, "call site %p live %10.1f KB, %u allocs", site.address, site.liveSize / 1024.0,
+                  static_cast<uint>(site.allocationCount));
+    }
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef MEMORYTRACKER_H_
+#define MEMORYTRACKER_H_
+
+/**
+ * @file
+ * Allocation tracking by category and call site.
+ *
+ * Built with MEMORY_TRACKING defined (CMake option USE_MEMORY_TRACKING),
+ * every MemoryAlloc() is charged to the memory category of the calling
+ * thread, see MemoryCategoryScope, and to its call site (the return
+ * address of MemoryAlloc()). A small header in front of each block keeps
+ * the size, category and call site for MemoryFree(). Each thread updates
+ * its own counters with plain stores, GetMemorySnapshot() sums them up, so
+ * an allocation costs a thread-local read, a call site lookup in a mostly
+ * read table and no shared writes. Only when the live size of a thread
+ * has changed by MEMORY_TRACKER_PEAK_GRANULARITY bytes it is added to a
+ * shared total, which the peak is kept for. Tracking can stay on in
+ * production builds. Block allocators charge their segments to the category that was
+ * current when they were constructed.
+ *
+ * Without MEMORY_TRACKING the scopes still work, but snapshots are empty.
+ */
+
+#include <stddef.h>
+#include "Base.h"
+
+// number of call sites tracked, further call sites are charged to slot 0
+#define MEMORY_TRACKER_CALL_SITE_COUNT      1024
+// number of call sites reported in a snapshot
+#define MEMORY_SNAPSHOT_CALL_SITE_COUNT     16
+// bytes a thread allocates or frees before it updates the peak, the peak
+// can be lower than the real one by this much per thread
+#define MEMORY_TRACKER_PEAK_GRANULARITY     (64 * 1024)
+
+namespace System
+{
+
+enum MemoryCategory
+{
+    MemoryCategoryGeneral = 0,
+    MemoryCategoryPool,
+    MemoryCategoryContainer,
+    MemoryCategoryString,
+    MemoryCategoryImage,
+    MemoryCategoryFile,
+    MemoryCategoryGraphics,
+    MemoryCategoryApp0,
+    MemoryCategoryApp1,
+    MemoryCategoryApp2,
+    MemoryCategoryApp3,
+    MemoryCategoryCount
+};
+
+/**
+ * Counters of one memory category. Cumulative counters wrap around, rates
+ * should be computed from differences of two snapshots.
+ */
+struct MemoryCategoryStatistics
+{
+    size_t liveSize;        // bytes allocated and not yet freed
+    size_t peakSize;        // highest liveSize, see MEMORY_TRACKER_PEAK_GRANULARITY
+    size_t liveCount;       // blocks allocated and not yet freed
+    size_t allocationCount; // cumulative
+    size_t allocatedSize;   // cumulative bytes
+};
+
+struct MemoryCallSiteStatistics
+{
+    void const *address;    // return address of MemoryAlloc(), null for untracked call sites
+    size_t liveSize;
+    size_t allocationCount; // cumulative
+};
+
+struct MemorySnapshot
+{
+    double time; // milliseconds since start-up
+    MemoryCategoryStatistics categories[MemoryCategoryCount];
+    // call sites with the most live bytes, largest first
+    MemoryCallSiteStatistics topCallSites[MEMORY_SNAPSHOT_CALL_SITE_COUNT];
+    int callSiteCount;
+};
+
+/**
+ * Returns true if the build tracks allocations.
+ */
+bool IsMemoryTrackingEnabled(void);
+
+/**
+ * Gets the category allocations of the calling thread are charged to.
+ */
+MemoryCategory GetMemoryCategory(void);
+
+/**
+ * Sets the category allocations of the calling thread are charged to.
+ * Prefer MemoryCategoryScope.
+ */
+void SetMemoryCategory(MemoryCategory category);
+
+char const *GetMemoryCategoryName(MemoryCategory category);
+
+/**
+ * Takes a snapshot of the counters. The counters are read one by one
+ * while other threads keep allocating, so they are not exactly consistent.
+ * @param snapshot - receives the counters
+ */
+void GetMemorySnapshot(MemorySnapshot &snapshot);
+
+/**
+ * Logs a snapshot to the LOG_MEM channel.
+ * @param snapshot - snapshot to log
+ * @param previous - optional older snapshot, used for allocation rates
+ */
+void LogMemorySnapshot(MemorySnapshot const &snapshot, MemorySnapshot const *previous = 0);
+
+// memory trace file: a MemoryTraceHeader followed by MemoryTraceRecords
+#define MEMORY_TRACE_MAGIC      0x544d564e // "NVMT"
+#define MEMORY_TRACE_VERSION    1
+
+struct MemoryTraceHeader
+{
+    uint magic;
+    uint version;
+};
+
+struct MemoryTraceRecord
+{
+    uint64 address; // identifies the block
+    uint size;      // requested size, 0 for a free
+    uint alignSize; // alignment of the block, at least MEMORY_TRACKING_HEADER_SIZE
+};
+
+/**
+ * Starts writing every tracked allocation and free to a file, to be
+ * replayed by Benchmark::MemoryAllocTrace(). Records are written under a
+ * lock, so tracing is meant for capture runs only; when it is off, the
+ * allocations pay one relaxed load for it.
+ * @param fileName - path of the trace file
+ * @return false if the file cannot be created, a trace is already being
+ * written or the build does not track allocations
+ */
+bool StartMemoryTrace(char const *fileName);
+
+/**
+ * Stops the trace started by StartMemoryTrace() and closes the file.
+ */
+void StopMemoryTrace(void);
+
+/**
+ * Charges allocations of the calling thread to a category till the end
+ * of the scope.
+ */
+class MemoryCategoryScope
+{
+public:
+    MemoryCategoryScope(MemoryCategory category)
+            : mPrevious(GetMemoryCategory())
+    {
+        SetMemoryCategory(category);
+    }
+
+    ~MemoryCategoryScope(void)
+    {
+        SetMemoryCategory(mPrevious);
+    }
+
+private:
+    MemoryCategoryScope(MemoryCategoryScope const &);
+    MemoryCategoryScope &operator=(MemoryCategoryScope const &);
+
+    MemoryCategory const mPrevious;
+};
+
+namespace Internal
+{
+
+// called by MemoryAlloc() and MemoryFree(), the header lies right in front of the block
+void TrackAllocation(void *ptr, size_t size, size_t offset, MemoryCategory category, void const *callSite);
+void TrackFree(void *ptr, size_t &offset);
+
+// bytes reserved in front of tracked blocks
+#define MEMORY_TRACKING_HEADER_SIZE 16
+
+}
+
+}
+
+#endif /* MEMORYTRACKER_H_ */
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef RESOURCESTLALLOCATOR_H_
+#define RESOURCESTLALLOCATOR_H_
+
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include "SystemCore.h"
+#include "MemoryResource.h"
+
+namespace NVR {
+
+/**
+ * Stateful STL allocator drawing from a MemoryResource with a fixed
+ * alignment, e.g. std::vector<Vector4f, ResourceStlAllocator<Vector4f> >
+ * on a PoolMemoryResource or an ArenaMemoryResource. construct() forwards
+ * its arguments, so emplace_back() builds elements in place. The resource
+ * follows the container on move assignment and swap, but not on copy
+ * assignment. Containers using different resources compare unequal,
+ * move assigning between them then moves the elements one by one.
+ *
+ * @param T - value type
+ * @param Alignment - alignment of the allocated arrays, at least that of T
+ */
+template<typename T, size_t Alignment = CACHELINE_ALIGNMENT> class ResourceStlAllocator
+{
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef T const * const_pointer;
+    typedef T& reference;
+    typedef T const & const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    enum
+    {
+        alignment = Alignment > __alignof__(T) ? Alignment : __alignof__(T)
+    };
+
+    ResourceStlAllocator(void)
+            : mResource(System::GetDefaultMemoryResource())
+    {
+    }
+
+    ResourceStlAllocator(System::MemoryResource *resource)
+            : mResource(resource)
+    {
+    }
+
+    template<typename U> ResourceStlAllocator(ResourceStlAllocator<U, Alignment> const &other)
+            : mResource(other.getResource())
+    {
+    }
+
+    /**
+     * Copy constructed containers get the default resource, a copy of an
+     * arena backed container should not silently live in that arena.
+     */
+    ResourceStlAllocator select_on_container_copy_construction(void) const
+    {
+        return ResourceStlAllocator();
+    }
+
+    pointer address(reference instance) const
+    {
+        return &instance;
+    }
+
+    const_pointer address(const_reference instance) const
+    {
+        return &instance;
+    }
+
+    size_type max_size(void) const
+    {
+        return (static_cast<size_type>(0) - static_cast<size_type>(1)) / sizeof(T);
+    }
+
+    pointer allocate(size_type n, void const *hint = 0) const
+    {
+        (void)hint;
+        return static_cast<pointer>(mResource->allocate(sizeof(T) * n, alignment));
+    }
+
+    void deallocate(pointer ptr, size_type n) const
+    {
+        mResource->deallocate(ptr, sizeof(T) * n, alignment);
+    }
+
+    template<typename U, typename ... Args> void construct(U *ptr, Args &&... args) const
+    {
+        new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U> void destroy(U *ptr) const
+    {
+        ptr->~U();
+    }
+
+    System::MemoryResource *getResource(void) const
+    {
+        return mResource;
+    }
+
+    // The following must be the same for all allocators.
+    template<typename U>
+    struct rebind
+    {
+        typedef ResourceStlAllocator<U, Alignment> other;
+    };
+
+private:
+    System::MemoryResource *mResource;
+};
+
+template<typename T, typename U, size_t Alignment>
+inline bool operator==(ResourceStlAllocator<T, Alignment> const &a, ResourceStlAllocator<U, Alignment> const &b)
+{
+    return a.getResource() == b.getResource();
+}
+
+template<typename T, typename U, size_t Alignment>
+inline bool operator!=(ResourceStlAllocator<T, Alignment> const &a, ResourceStlAllocator<U, Alignment> const &b)
+{
+    return a.getResource() != b.getResource();
+}
+
+}
+
+#endif /* RESOURCESTLALLOCATOR_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef SIGNAL_H_
+#define SIGNAL_H_
+
+/**
+ * @file
+ * Definition of Signal.
+ */
+
+#include "Delegate.h"
+
+namespace NVR {
+
+/**
+ * Multicast event. Up to Capacity delegates subscribe with connect(), and
+ * emitting the signal calls them in subscription order. Subscribers are
+ * stored inline, so the signal never allocates. The class is not
+ * thread-safe: subscribe during initialization, or on the thread that
+ * emits the signal. A subscriber may disconnect itself while being called.
+ *
+ * @param Capacity - maximal number of subscribers
+ * @param Args - argument types of the event
+ */
+template<int Capacity, typename ... Args> class Signal
+{
+public:
+    typedef Delegate<void, Args...> Slot;
+
+    Signal(void)
+            : mCount(0)
+    {
+    }
+
+    /**
+     * Subscribes a delegate.
+     * @param slot - delegate to call, not subscribed already
+     * @return false if the signal is full
+     */
+    bool connect(Slot const &slot)
+    {
+        if (mCount == Capacity)
+        {
+            return false;
+        }
+
+        mSlots[mCount++] = slot;
+        return true;
+    }
+
+    /**
+     * Unsubscribes a delegate.
+     * @param slot - delegate passed to connect()
+     * @return false if it was not subscribed
+     */
+    bool disconnect(Slot const &slot)
+    {
+        for (int i = 0; i < mCount; i++)
+        {
+            if (mSlots[i] == slot)
+            {
+                // keep the order of the remaining subscribers
+                for (mCount--; i < mCount; i++)
+                {
+                    mSlots[i] = mSlots[i + 1];
+                }
+                mSlots[mCount] = Slot();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void disconnectAll(void)
+    {
+        while (mCount > 0)
+        {
+            mSlots[--mCount] = Slot();
+        }
+    }
+
+    /**
+     * Calls all subscribers.
+     * @param args - event arguments, passed to each subscriber
+     */
+    void emit(Args ... args) const
+    {
+        for (int i = 0; i < mCount; i++)
+        {
+            Slot const slot = mSlots[i];
+            slot(args...);
+
+            // the subscriber disconnected itself
+            if (i < mCount && mSlots[i] != slot)
+            {
+                i--;
+            }
+        }
+    }
+
+    void operator()(Args ... args) const
+    {
+        emit(args...);
+    }
+
+    int getCount(void) const
+    {
+        return mCount;
+    }
+
+    bool isEmpty(void) const
+    {
+        return mCount == 0;
+    }
+
+private:
+    // prevent copy construction and assignment
+    Signal(Signal const &instance);
+    Signal &operator=(Signal const &instance);
+
+    Slot mSlots[Capacity];
+    int mCount;
+};
+
+}
+
+#endif /* SIGNAL_H_ */
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#include <stdlib.h>
+#if !defined(__APPLE__) || !defined(__MACH__)
+#include <malloc.h>
+#endif
+#include <sched.h>
+#include <atomic>
+#include "SizeClassAllocator.h"
+#include "HugePageAllocator.h"
+
+// the class of large allocations, which have a span of their own
+#define SIZE_CLASS_LARGE            SIZE_CLASS_COUNT
+// span header size, blocks start behind it
+#define SIZE_CLASS_HEADER_SIZE      CACHELINE_ALIGNMENT
+
+namespace
+{
+
+typedef struct SpanHeaderStruct
+{
+    int sizeClass;
+    size_t size;        // usable size of large allocations
+    void *base;         // start of the system allocation
+    size_t mappedSize;  // non-zero if the span is a huge page mapping
+} SpanHeader;
+
+typedef struct FreeBlockStruct
+{
+    struct FreeBlockStruct *next;
+} FreeBlock;
+
+// zero initialized, so that the allocator works before static constructors run
+struct SizeClass
+{
+    std::atomic<int> lock;
+    FreeBlock *freeRoot;
+    uchar *carveBegin; // uncarved rest of the current span
+    uchar *carveEnd;
+};
+
+SizeClass g_SizeClasses[SIZE_CLASS_COUNT];
+
+FORCE_INLINE void LockSizeClass(SizeClass &sc)
+{
+    // critical sections are a few instructions long, spin before yielding
+    int spin = 0;
+    while (sc.lock.exchange(1, std::memory_order_acquire) != 0)
+    {
+        if (++spin > 64)
+        {
+            sched_yield();
+            spin = 0;
+        }
+    }
+}
+
+FORCE_INLINE void UnlockSizeClass(SizeClass &sc)
+{
+    sc.lock.store(0, std::memory_order_release);
+}
+
+FORCE_INLINE size_t GetSizeClassBlockSize(int index)
+{
+    if (index < 4)
+    {
+        return (index + 1) << 4;
+    }
+
+    int const shift = 6 + ((index - 4) >> 2);
+    return (static_cast<size_t>(1) << shift) + (static_cast<size_t>(((index - 4) & 3) + 1) << (shift - 2));
+}
+
+FORCE_INLINE size_t GetSizeClassAlignment(int index)
+{
+    size_t const blockSize = GetSizeClassBlockSize(index);
+    size_t const alignment = blockSize & (~blockSize + 1);
+    return alignment < SIZE_CLASS_MAX_ALIGNMENT ? alignment : SIZE_CLASS_MAX_ALIGNMENT;
+}
+
+FORCE_INLINE int GetSizeClassIndex(size_t size, size_t alignSize)
+{
+    if (size > SIZE_CLASS_MAX_SIZE || alignSize > SIZE_CLASS_MAX_ALIGNMENT)
+    {
+        return SIZE_CLASS_LARGE;
+    }
+
+    int index;
+    if (size <= 64)
+    {
+        index = size == 0 ? 0 : static_cast<int>((size + 15) >> 4) - 1;
+    }
+    else
+    {
+        // size is in (2^shift, 2^(shift+1)], split into four classes
+        int const shift = 31 - __builtin_clz(static_cast<uint>(size - 1));
+        index = 4 + ((shift - 6) << 2) + static_cast<int>((size - (static_cast<size_t>(1) << shift) - 1) >> (shift - 2));
+    }
+
+    // all classes are 16 byte aligned
+    if (alignSize > 16)
+    {
+        while (GetSizeClassAlignment(index) < alignSize)
+        {
+            if (++index == SIZE_CLASS_COUNT)
+            {
+                return SIZE_CLASS_LARGE;
+            }
+        }
+    }
+
+    return index;
+}
+
+void *AllocateSpan(size_t size, size_t alignSize)
+{
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignSize);
+#elif defined(ANDROID)
+    return memalign(alignSize, size);
+#else
+    void *ptr;
+    return posix_memalign(&ptr, alignSize, size) == 0 ? ptr : 0;
+#endif
+}
+
+void FreeSpan(void *ptr)
+{
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// blocks never start at a span boundary, so the byte before them is in the span
+FORCE_INLINE SpanHeader *GetSpanHeader(void const *ptr)
+{
+    return reinterpret_cast<SpanHeader *>((reinterpret_cast<size_t>(ptr) - 1) & ~static_cast<size_t>(SIZE_CLASS_SPAN_SIZE - 1));
+}
+
+bool CarveNewSpan(SizeClass &sc, int index)
+{
+    SpanHeader *span = static_cast<SpanHeader *>(AllocateSpan(SIZE_CLASS_SPAN_SIZE, SIZE_CLASS_SPAN_SIZE));
+    if (span == 0)
+    {
+        return false;
+    }
+
+    span->sizeClass = index;
+    span->size = GetSizeClassBlockSize(index);
+    span->base = span;
+    span->mappedSize = 0;
+
+    size_t const alignment = GetSizeClassAlignment(index);
+    size_t const offset = alignment > SIZE_CLASS_HEADER_SIZE ? alignment : SIZE_CLASS_HEADER_SIZE;
+    size_t const blockCount = (SIZE_CLASS_SPAN_SIZE - offset) / span->size;
+
+    sc.carveBegin = reinterpret_cast<uchar *>(span) + offset;
+    sc.carveEnd = sc.carveBegin + blockCount * span->size;
+
+    return true;
+}
+
+void *AllocateLarge(size_t size, size_t alignSize, uint flags)
+{
+    // the header sits on the last span boundary before the returned pointer
+    size_t const offset = alignSize > SIZE_CLASS_HEADER_SIZE ? alignSize : SIZE_CLASS_HEADER_SIZE;
+    size_t const spanAlignment = alignSize > SIZE_CLASS_SPAN_SIZE ? alignSize : SIZE_CLASS_SPAN_SIZE;
+
+    uchar *base = 0;
+    size_t mappedSize = 0;
+    if ((flags & MEMORY_ALLOC_HUGE_PAGES) != 0 && size >= HUGE_PAGE_MIN_ALLOCATION_SIZE
+            && spanAlignment <= HUGE_PAGE_SIZE)
+    {
+        base = static_cast<uchar *>(System::Internal::HugePageMap(offset + size, mappedSize));
+    }
+    if (base == 0)
+    {
+        base = static_cast<uchar *>(AllocateSpan(offset + size, spanAlignment));
+        if (base == 0)
+        {
+            return 0;
+        }
+    }
+
+    uchar *ptr = base + offset;
+    SpanHeader *span = GetSpanHeader(ptr);
+    span->sizeClass = SIZE_CLASS_LARGE;
+    span->size = size;
+    span->base = base;
+    span->mappedSize = mappedSize;
+
+    return ptr;
+}
+
+}
+
+void *System::Internal::SizeClassAlloc(size_t size, size_t alignSize, uint flags)
+{
+    int const index = GetSizeClassIndex(size, alignSize);
+    if (index == SIZE_CLASS_LARGE)
+    {
+        return AllocateLarge(size, alignSize, flags);
+    }
+
+    SizeClass &sc = g_SizeClasses[index];
+    void *ptr;
+
+    LockSizeClass(sc);
+
+    if (sc.freeRoot != 0)
+    {
+        // reuse a released block
+        ptr = sc.freeRoot;
+        sc.freeRoot = sc.freeRoot->next;
+    }
+    else if (sc.carveBegin != sc.carveEnd || CarveNewSpan(sc, index))
+    {
+        ptr = sc.carveBegin;
+        sc.carveBegin += GetSizeClassBlockSize(index);
+    }
+    else
+    {
+        ptr = 0;
+    }
+
+    UnlockSizeClass(sc);
+
+    return ptr;
+}
+
+void System::Internal::SizeClassFree(void *ptr)
+{
+    if (ptr == 0)
+    {
+        return;
+    }
+
+    SpanHeader *span = GetSpanHeader(ptr);
+    if (span->sizeClass == SIZE_CLASS_LARGE)
+    {
+        if (span->mappedSize != 0)
+        {
+            HugePageUnmap(span->base, span->mappedSize);
+        }
+        else
+        {
+            FreeSpan(span->base);
+        }
+        return;
+    }
+
+    SizeClass &sc = g_SizeClasses[span->sizeClass];
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+
+    LockSizeClass(sc);
+    block->next = sc.freeRoot;
+    sc.freeRoot = block;
+    UnlockSizeClass(sc);
+}
+
+size_t System::Internal::SizeClassGetUsableSize(void const *ptr)
+{
+    return GetSpanHeader(ptr)->size;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef SIZECLASSALLOCATOR_H_
+#define SIZECLASSALLOCATOR_H_
+
+/**
+ * @file
+ * Size-class general-purpose allocator, the optional backend of
+ * System::MemoryAlloc() and System::MemoryFree().
+ *
+ * Requests up to SIZE_CLASS_MAX_SIZE bytes are rounded up to one of
+ * SIZE_CLASS_COUNT classes (16 byte steps up to 64, then four classes per
+ * power of two) and served from a per-class free list, the same way
+ * BlockAllocator serves its blocks. Blocks are carved from spans of
+ * SIZE_CLASS_SPAN_SIZE bytes aligned to their size, the span header tells
+ * the class of a block on free, so blocks carry no per-allocation header.
+ * Every class is naturally aligned to the largest power of two dividing
+ * its block size, an aligned request just picks the first class that is
+ * aligned enough instead of over-allocating. Larger or more aligned
+ * requests get a span of their own.
+ *
+ * Build with MEMORY_SIZE_CLASS_ALLOCATOR defined (CMake option
+ * USE_SIZE_CLASS_ALLOCATOR) to route MemoryAlloc() through it. Memory is
+ * kept by the classes once allocated and never returned to the system.
+ */
+
+#include <stddef.h>
+#include "Base.h"
+#include "SystemCore.h"
+
+// size of the memory spans small blocks are carved from, power of two
+#define SIZE_CLASS_SPAN_SIZE        65536
+// largest request served by a size class
+#define SIZE_CLASS_MAX_SIZE         8192
+// largest alignment served by a size class
+#define SIZE_CLASS_MAX_ALIGNMENT    4096
+// number of size classes
+#define SIZE_CLASS_COUNT            32
+
+namespace System
+{
+
+namespace Internal
+{
+
+/**
+ * Allocates memory from the size classes.
+ * @param size - requested size in bytes
+ * @param alignSize - requested alignment, power of two
+ * @param flags - MEMORY_ALLOC_HUGE_PAGES maps large requests to huge pages
+ * @return pointer to the memory or null if out of memory
+ */
+void *SizeClassAlloc(size_t size, size_t alignSize = 1, uint flags = MEMORY_ALLOC_DEFAULT);
+
+/**
+ * Releases memory allocated by SizeClassAlloc().
+ * @param ptr - pointer to the memory, may be null
+ */
+void SizeClassFree(void *ptr);
+
+/**
+ * Gets the number of bytes usable in a block allocated by SizeClassAlloc().
+ * @param ptr - pointer to the memory
+ */
+size_t SizeClassGetUsableSize(void const *ptr);
+
+}
+
+}
+
+#endif /* SIZECLASSALLOCATOR_H_ */
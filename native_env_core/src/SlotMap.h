@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef _SLOTMAP_H
+#define _SLOTMAP_H
+
+/**
+ * @file
+ * Definition of SlotMap.
+ */
+
+#include <utility>
+#include "Base.h"
+#include "SystemCore.h"
+#include "MemAlloc.h"
+
+namespace NVR
+{
+
+// number of elements in one storage chunk of a SlotMap, power of two
+#define SLOT_MAP_CHUNK_SHIFT    8
+#define SLOT_MAP_CHUNK_SIZE     (1 << SLOT_MAP_CHUNK_SHIFT)
+
+/**
+ * Container handing out generational handles instead of pointers, for
+ * long lived objects (frames, textures, keyframes) referenced from many
+ * places. A handle packs a slot index and the generation of the slot; the
+ * generation changes when the element is removed, so stale handles are
+ * detected instead of reaching a reused object. Lookup is two array
+ * accesses.
+ *
+ * Elements are kept densely packed: removing one moves the last element
+ * into its place, so iteration with size() and at() walks memory
+ * linearly. Pointers to elements are therefore only valid till the next
+ * remove(); keep handles. Storage grows in chunks of SLOT_MAP_CHUNK_SIZE
+ * elements taken from a BlockAllocator, growing never moves elements.
+ *
+ * 32-bit handles use 20 index bits and 12 generation bits, 64-bit handles
+ * 32 and 32. A slot whose generation would wrap is retired for good, so a
+ * handle never matches an element it was not issued for. Handle 0 is
+ * never issued. The class is not thread-safe.
+ */
+template<typename T, typename H = uint> class SlotMap
+{
+    static_assert(sizeof(H) == sizeof(uint) || sizeof(H) == sizeof(uint64), "SlotMap needs 32 or 64-bit handles");
+
+public:
+    typedef H Handle;
+
+    enum
+    {
+        IndexBits = sizeof(H) == sizeof(uint) ? 20 : 32,
+        GenerationBits = sizeof(H) * 8 - IndexBits
+    };
+
+    /**
+     * Default constructor.
+     * @param initialChunkCount - number of storage chunks allocated up front
+     */
+    SlotMap(uint initialChunkCount = 1)
+            : mChunkAllocator(sizeof(T) * SLOT_MAP_CHUNK_SIZE, initialChunkCount < 1 ? 1 : initialChunkCount),
+              mChunks(0), mChunkCount(0), mChunkArraySize(0), mSlots(0), mDenseToSlot(0), mSlotCount(0),
+              mSlotArraySize(0), mSize(0), mFreeSlot(NoSlot)
+    {
+    }
+
+    ~SlotMap(void)
+    {
+        clear();
+        System::MemoryFree(mChunks);
+        System::MemoryFree(mSlots);
+        System::MemoryFree(mDenseToSlot);
+    }
+
+    /**
+     * Adds an element constructed from the arguments.
+     * @return handle of the element, 0 if the index space is exhausted
+     */
+    template<typename ... Args> Handle insert(Args &&... args)
+    {
+        uint slot = mFreeSlot;
+        if (slot != NoSlot)
+        {
+            mFreeSlot = mSlots[slot].denseIndex;
+        }
+        else
+        {
+            if (mSlotCount == MaxSlotCount)
+            {
+                return 0;
+            }
+            slot = mSlotCount++;
+            reserveSlots(mSlotCount);
+            mSlots[slot].generation = 1;
+        }
+
+        if ((mSize >> SLOT_MAP_CHUNK_SHIFT) == mChunkCount)
+        {
+            addChunk();
+        }
+
+        uint const denseIndex = mSize++;
+        new (static_cast<void *>(&at(denseIndex))) T(std::forward<Args>(args)...);
+        mSlots[slot].denseIndex = denseIndex;
+        mDenseToSlot[denseIndex] = slot;
+
+        return makeHandle(slot, mSlots[slot].generation);
+    }
+
+    /**
+     * Removes an element. The last element is moved into its place.
+     * @param handle - handle of the element
+     * @return false if the handle is stale or invalid
+     */
+    bool remove(Handle handle)
+    {
+        uint const slot = static_cast<uint>(handle & IndexMask);
+        if (!isLive(handle, slot))
+        {
+            return false;
+        }
+
+        uint const denseIndex = mSlots[slot].denseIndex;
+        uint const lastIndex = --mSize;
+        if (denseIndex != lastIndex)
+        {
+            at(denseIndex) = std::move(at(lastIndex));
+            uint const movedSlot = mDenseToSlot[lastIndex];
+            mSlots[movedSlot].denseIndex = denseIndex;
+            mDenseToSlot[denseIndex] = movedSlot;
+        }
+        at(lastIndex).~T();
+
+        // retire the slot with generation 0 rather than let its generation wrap
+        if (mSlots[slot].generation < MaxGeneration)
+        {
+            mSlots[slot].generation++;
+            mSlots[slot].denseIndex = mFreeSlot;
+            mFreeSlot = slot;
+        }
+        else
+        {
+            mSlots[slot].generation = 0;
+        }
+
+        return true;
+    }
+
+    /**
+     * Finds an element.
+     * @param handle - handle of the element
+     * @return the element or null if the handle is stale or invalid
+     */
+    T *get(Handle handle)
+    {
+        uint const slot = static_cast<uint>(handle & IndexMask);
+        return isLive(handle, slot) ? &at(mSlots[slot].denseIndex) : 0;
+    }
+
+    T const *get(Handle handle) const
+    {
+        uint const slot = static_cast<uint>(handle & IndexMask);
+        return isLive(handle, slot) ? &at(mSlots[slot].denseIndex) : 0;
+    }
+
+    bool contains(Handle handle) const
+    {
+        return isLive(handle, static_cast<uint>(handle & IndexMask));
+    }
+
+    /**
+     * Gets an element by its position in the dense storage, for iteration.
+     * @param denseIndex - position in [0, size())
+     */
+    FORCE_INLINE T &at(uint denseIndex)
+    {
+        return reinterpret_cast<T *>(mChunks[denseIndex >> SLOT_MAP_CHUNK_SHIFT])[denseIndex & (SLOT_MAP_CHUNK_SIZE - 1)];
+    }
+
+    FORCE_INLINE T const &at(uint denseIndex) const
+    {
+        return reinterpret_cast<T const *>(mChunks[denseIndex >> SLOT_MAP_CHUNK_SHIFT])[denseIndex & (SLOT_MAP_CHUNK_SIZE - 1)];
+    }
+
+    /**
+     * Gets the handle of an element by its position in the dense storage.
+     */
+    Handle getHandle(uint denseIndex) const
+    {
+        uint const slot = mDenseToSlot[denseIndex];
+        return makeHandle(slot, mSlots[slot].generation);
+    }
+
+    /**
+     * Calls the visitor for every element in storage order. The visitor
+     * must not insert or remove elements.
+     * @param visitor - callable invoked with each element
+     */
+    template<typename V> void visit(V &visitor)
+    {
+        for (uint chunk = 0; chunk << SLOT_MAP_CHUNK_SHIFT < mSize; chunk++)
+        {
+            T *elements = reinterpret_cast<T *>(mChunks[chunk]);
+            uint const count = mSize - (chunk << SLOT_MAP_CHUNK_SHIFT) < SLOT_MAP_CHUNK_SIZE ?
+                    mSize - (chunk << SLOT_MAP_CHUNK_SHIFT) : SLOT_MAP_CHUNK_SIZE;
+            for (uint i = 0; i < count; i++)
+            {
+                visitor(elements[i]);
+            }
+        }
+    }
+
+    uint size(void) const
+    {
+        return mSize;
+    }
+
+    bool empty(void) const
+    {
+        return mSize == 0;
+    }
+
+    /**
+     * Removes all elements. Handles issued so far stay invalid.
+     */
+    void clear(void)
+    {
+        while (mSize != 0)
+        {
+            remove(getHandle(mSize - 1));
+        }
+    }
+
+private:
+    // prevent copy construction and assignment
+    SlotMap(SlotMap const &);
+    SlotMap &operator=(SlotMap const &);
+
+    static H const IndexMask = (static_cast<H>(1) << IndexBits) - 1;
+    static uint const MaxSlotCount = static_cast<uint>(IndexMask);
+    static uint const MaxGeneration = static_cast<uint>((static_cast<uint64>(1) << GenerationBits) - 1);
+    static uint const NoSlot = ~0u;
+
+    struct Slot
+    {
+        uint denseIndex; // next free slot while the slot is free
+        uint generation;
+    };
+
+    static Handle makeHandle(uint slot, uint generation)
+    {
+        return (static_cast<H>(generation) << IndexBits) | slot;
+    }
+
+    bool isLive(Handle handle, uint slot) const
+    {
+        // a free slot already carries its next generation, its index links the free list
+        if (slot >= mSlotCount || mSlots[slot].generation == 0
+                || static_cast<uint>(handle >> IndexBits) != mSlots[slot].generation)
+        {
+            return false;
+        }
+
+        uint const denseIndex = mSlots[slot].denseIndex;
+        return denseIndex < mSize && mDenseToSlot[denseIndex] == slot;
+    }
+
+    void reserveSlots(uint count)
+    {
+        if (count <= mSlotArraySize)
+        {
+            return;
+        }
+
+        uint const newSize = mSlotArraySize != 0 ? mSlotArraySize << 1 : SLOT_MAP_CHUNK_SIZE;
+        Slot *slots = System::MemoryAlloc<Slot>(newSize);
+        uint *denseToSlot = System::MemoryAlloc<uint>(newSize);
+        if (mSlotArraySize != 0)
+        {
+            System::MemoryCopy(slots, mSlots, sizeof(Slot) * mSlotArraySize);
+            System::MemoryCopy(denseToSlot, mDenseToSlot, sizeof(uint) * mSlotArraySize);
+        }
+        System::MemoryFree(mSlots);
+        System::MemoryFree(mDenseToSlot);
+
+        mSlots = slots;
+        mDenseToSlot = denseToSlot;
+        mSlotArraySize = newSize;
+    }
+
+    void addChunk(void)
+    {
+        if (mChunkCount == mChunkArraySize)
+        {
+            uint const newSize = mChunkArraySize != 0 ? mChunkArraySize << 1 : 4;
+            uchar **chunks = System::MemoryAlloc<uchar *>(newSize);
+            if (mChunkArraySize != 0)
+            {
+                System::MemoryCopy(chunks, mChunks, sizeof(uchar *) * mChunkArraySize);
+            }
+            System::MemoryFree(mChunks);
+            mChunks = chunks;
+            mChunkArraySize = newSize;
+        }
+
+        mChunks[mChunkCount++] = mChunkAllocator.allocate();
+    }
+
+    System::BlockAllocator mChunkAllocator;
+    uchar **mChunks; // chunks stay allocated once the size has reached them
+    uint mChunkCount;
+    uint mChunkArraySize;
+
+    Slot *mSlots;
+    uint *mDenseToSlot; // element position to slot index
+    uint mSlotCount;
+    uint mSlotArraySize;
+
+    uint mSize;
+    uint mFreeSlot; // head of the free slot list
+};
+
+}
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2012-2013, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA Corporation and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA Corporation is strictly prohibited.
+ */
+
+#ifndef STRINGINDEX_H_
+#define STRINGINDEX_H_
+
+/**
+ * @file
+ * Definition of StringIndex.
+ */
+
+#include "Base.h"
+#include "SystemCore.h"
+#include "ManagedPtr.h"
+#include "MemAlloc.h"
+#include "BTrie.h"
+
+namespace System
+{
+
+template<typename V> class StringIndex;
+
+/**
+ * Interned string with an attached value, owned by a StringIndex.
+ */
+template<typename V> class StringIndexEntry: public NVR::BTrieNode<StringIndexEntry<V>, uint>
+{
+public:
+    StringIndexEntry(void)
+            : mNextCollision(0), mString(0), mLength(0), mValue()
+    {
+    }
+
+    /**
+     * Gets the interned copy of the string. The pointer stays valid for the
+     * lifetime of the index, so it can be compared by address.
+     */
+    char const *getString(void) const
+    {
+        return mString;
+    }
+
+    int getLength(void) const
+    {
+        return mLength;
+    }
+
+    V const &value(void) const
+    {
+        return mValue;
+    }
+
+    V &value(void)
+    {
+        return mValue;
+    }
+
+private:
+    template<typename U> friend class StringIndex;
+
+    StringIndexEntry *mNextCollision; // other strings with the same hash
+    char const *mString;
+    int mLength;
+    V mValue;
+};
+
+// size of the blocks interned strings are copied to
+#define STRING_INDEX_CHUNK_SIZE 4096
+
+/**
+ * Interned string table mapping strings (asset names, shader names, paths)
+ * to values. Strings are keyed by StringHash() in a BTrie, entries with
+ * colliding hashes are chained behind the trie node. A lookup costs one
+ * hash, a short trie walk and one string compare. Entries come from a
+ * block allocator and strings are copied into shared chunks, so interning
+ * does not allocate per string. The class is not thread-safe.
+ */
+template<typename V> class StringIndex: public ManagedAbstractObject
+{
+public:
+    typedef StringIndexEntry<V> Entry;
+
+    /**
+     * Default constructor.
+     * @param initialCapacity - number of entries allocated up front
+     */
+    StringIndex(uint initialCapacity = BLOCK_ALLOCATOR_MIN_CAPACITY)
+            : mEntryAllocator(initialCapacity), mChunks(0), mChunkOffset(STRING_INDEX_CHUNK_SIZE), mCount(0)
+    {
+    }
+
+    ~StringIndex(void)
+    {
+        clear();
+    }
+
+    /**
+     * Finds an entry.
+     * @param str - null terminated string
+     * @return found entry or null
+     */
+    Entry *find(char const *str) const
+    {
+        Entry *entry = mTrie.get(StringHash(str));
+        while (entry != 0 && !StringCompare(entry->mString, str))
+        {
+            entry = entry->mNextCollision;
+        }
+
+        return entry;
+    }
+
+    /**
+     * Finds an entry, adding it with a default constructed value if the
+     * string is not in the index yet.
+     * @param str - null terminated string
+     * @return entry of the string
+     */
+    Entry *intern(char const *str)
+    {
+        uint const hash = StringHash(str);
+        Entry *head = mTrie.get(hash);
+
+        for (Entry *entry = head; entry != 0; entry = entry->mNextCollision)
+        {
+            if (StringCompare(entry->mString, str))
+            {
+                return entry;
+            }
+        }
+
+        Entry *entry = mEntryAllocator.allocate();
+        entry->key() = hash;
+        entry->mLength = StringLength(str);
+        entry->mString = copyString(str, entry->mLength);
+
+        if (head != 0)
+        {
+            entry->mNextCollision = head->mNextCollision;
+            head->mNextCollision = entry;
+        }
+        else
+        {
+            mTrie.insert(entry);
+        }
+
+        mCount++;
+
+        return entry;
+    }
+
+    /**
+     * Removes an entry. The memory of the interned string is only
+     * released by clear().
+     * @param str - null terminated string
+     * @return true if the string was found
+     */
+    bool remove(char const *str)
+    {
+        uint const hash = StringHash(str);
+        Entry *head = mTrie.get(hash);
+        Entry *previous = 0;
+        Entry *entry = head;
+
+        while (entry != 0 && !StringCompare(entry->mString, str))
+        {
+            previous = entry;
+            entry = entry->mNextCollision;
+        }
+
+        if (entry == 0)
+        {
+            return false;
+        }
+
+        if (previous != 0)
+        {
+            previous->mNextCollision = entry->mNextCollision;
+        }
+        else
+        {
+            // the chain head lives in the trie, promote the next one
+            mTrie.remove(hash);
+            if (entry->mNextCollision != 0)
+            {
+                mTrie.insert(entry->mNextCollision);
+            }
+        }
+
+        mEntryAllocator.deallocate(entry);
+        mCount--;
+
+        return true;
+    }
+
+    /**
+     * Removes all entries and releases the interned strings.
+     */
+    void clear(void)
+    {
+        Entry *entry;
+        while ((entry = mTrie.getMinimum()) != 0)
+        {
+            mTrie.remove(entry->key());
+            while (entry != 0)
+            {
+                Entry *next = entry->mNextCollision;
+                mEntryAllocator.deallocate(entry);
+                entry = next;
+            }
+        }
+
+        while (mChunks != 0)
+        {
+            StringChunk *next = mChunks->next;
+            MemoryFree(mChunks);
+            mChunks = next;
+        }
+
+        mChunkOffset = STRING_INDEX_CHUNK_SIZE;
+        mCount = 0;
+    }
+
+    int getCount(void) const
+    {
+        return mCount;
+    }
+
+private:
+    // prevent copy construction and assignment
+    StringIndex(StringIndex const &instance);
+    StringIndex &operator=(StringIndex const &instance);
+
+    struct StringChunk
+    {
+        StringChunk *next;
+    };
+
+    char const *copyString(char const *str, int length)
+    {
+        int const size = length + 1;
+        char *dest;
+
+        if (size > STRING_INDEX_CHUNK_SIZE / 4)
+        {
+            // long strings get a chunk of their own, behind the current one
+            StringChunk *chunk = unsafe_pointer_cast<StringChunk>(
+                    MemoryAlloc<uchar>(sizeof(StringChunk) + size, sizeof(void *)));
+            if (mChunks != 0)
+            {
+                chunk->next = mChunks->next;
+                mChunks->next = chunk;
+            }
+            else
+            {
+                chunk->next = 0;
+                mChunks = chunk;
+                mChunkOffset = STRING_INDEX_CHUNK_SIZE;
+            }
+            dest = reinterpret_cast<char *>(chunk + 1);
+        }
+        else
+        {
+            if (mChunkOffset + size > STRING_INDEX_CHUNK_SIZE)
+            {
+                StringChunk *chunk = unsafe_pointer_cast<StringChunk>(
+                        MemoryAlloc<uchar>(sizeof(StringChunk) + STRING_INDEX_CHUNK_SIZE, sizeof(void *)));
+                chunk->next = mChunks;
+                mChunks = chunk;
+                mChunkOffset = 0;
+            }
+            dest = reinterpret_cast<char *>(mChunks + 1) + mChunkOffset;
+            mChunkOffset += size;
+        }
+
+        MemoryCopy(dest, str, size);
+
+        return dest;
+    }
+
+    NVR::BTrie<Entry> mTrie;
+    TypedBlockAllocator<Entry> mEntryAllocator;
+
+    StringChunk *mChunks; // most recent first, the first one is being filled
+    int mChunkOffset;
+    int mCount;
+};
+
+}
+
+#endif /* STRINGINDEX_H_ */
@@ -24,6 +24,11 @@
 #endif
 #include <stdarg.h>
 #include "SystemCore.h"
+#include "HugePageAllocator.h"
+#include "MemoryTracker.h"
+#ifdef MEMORY_SIZE_CLASS_ALLOCATOR
+#include "SizeClassAllocator.h"
+#endif
 
 static void DefaultLogBufferDumpProc(int level, char const *str);
 static void DefaultLogBufferUnicodeDumpProc(int level, ushort const *str);
@@ -37,8 +42,82 @@ static System::LogBufferUnicodeDumpProc g_LogBufferUnicodeDumpProc = DefaultLogB
 // MEMORY
 // ==========================================================================
 
-void *System::Internal::MemoryAlloc(size_t size, size_t alignSize)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RETURN_ADDRESS() (_ReturnAddress())
+#else
+#define RETURN_ADDRESS() (__builtin_return_address(0))
+#endif
+
+static FORCE_INLINE void *BackendMemoryAlloc(size_t size, size_t alignSize, uint flags)
+{
+#ifdef MEMORY_SIZE_CLASS_ALLOCATOR
+    return System::Internal::SizeClassAlloc(size, alignSize, flags);
+#else
+    return System::Internal::HeapMemoryAlloc(size, alignSize, flags);
+#endif
+}
+
+static FORCE_INLINE void BackendMemoryFree(void *ptr)
+{
+#ifdef MEMORY_SIZE_CLASS_ALLOCATOR
+    System::Internal::SizeClassFree(ptr);
+#else
+    System::Internal::HeapMemoryFree(ptr);
+#endif
+}
+
+void *System::Internal::MemoryAlloc(size_t size, size_t alignSize, uint flags)
 {
+#ifdef MEMORY_TRACKING
+    // room for the tracking header, keeping the requested alignment
+    size_t const offset = alignSize > MEMORY_TRACKING_HEADER_SIZE ? alignSize : MEMORY_TRACKING_HEADER_SIZE;
+    uchar *ptr = static_cast<uchar *>(BackendMemoryAlloc(size + offset, offset, flags));
+    if (ptr == 0)
+    {
+        return 0;
+    }
+
+    ptr += offset;
+    TrackAllocation(ptr, size, offset, GetMemoryCategory(), RETURN_ADDRESS());
+    return ptr;
+#else
+    return BackendMemoryAlloc(size, alignSize, flags);
+#endif
+}
+
+void System::MemoryFree(void *ptr)
+{
+#ifdef MEMORY_TRACKING
+    if (ptr != 0)
+    {
+        size_t offset;
+        Internal::TrackFree(ptr, offset);
+        BackendMemoryFree(static_cast<uchar *>(ptr) - offset);
+    }
+#else
+    BackendMemoryFree(ptr);
+#endif
+}
+
+void *System::Internal::HeapMemoryAlloc(size_t size, size_t alignSize, uint flags)
+{
+    if ((flags & MEMORY_ALLOC_HUGE_PAGES) != 0 && size >= HUGE_PAGE_MIN_ALLOCATION_SIZE
+            && alignSize <= HUGE_PAGE_SIZE)
+    {
+        // the pointer in front is tagged by its low bit, the mapping size precedes it
+        size_t const offset = alignSize > 2 * sizeof(void *) ? alignSize : 2 * sizeof(void *);
+        size_t mappedSize;
+        uchar *base = static_cast<uchar *>(HugePageMap(offset + size, mappedSize));
+        if (base != 0)
+        {
+            void **aptr = (void **)(base + offset);
+            aptr[-1] = (void *)((size_t)base | 1);
+            aptr[-2] = (void *)mappedSize;
+            return aptr;
+        }
+    }
+
     void *ptr = malloc(size + alignSize + sizeof(void *));
     if (ptr == 0)
     {
@@ -50,11 +129,19 @@ void *System::Internal::MemoryAlloc(size_t size, size_t alignSize)
     return aptr;
 }
 
-void System::MemoryFree(void *ptr)
+void System::Internal::HeapMemoryFree(void *ptr)
 {
     if (ptr != 0)
     {
-        free(((void **)ptr)[-1]);
+        void *base = ((void **)ptr)[-1];
+        if (((size_t)base & 1) != 0)
+        {
+            HugePageUnmap((void *)((size_t)base & ~(size_t)1), (size_t)((void **)ptr)[-2]);
+        }
+        else
+        {
+            free(base);
+        }
     }
 }
 
@@ -46,9 +46,18 @@ namespace System
 {
 
 // MEMORY
+
+// MemoryAlloc() flags
+#define MEMORY_ALLOC_DEFAULT        0x0
+// back large allocations by huge pages where supported, see HugePageAllocator.h
+#define MEMORY_ALLOC_HUGE_PAGES     0x1
+
 namespace Internal
 {
-void *MemoryAlloc(size_t size, size_t alignSize = 1);
+void *MemoryAlloc(size_t size, size_t alignSize = 1, uint flags = MEMORY_ALLOC_DEFAULT);
+// malloc based backend, used unless MEMORY_SIZE_CLASS_ALLOCATOR is defined
+void *HeapMemoryAlloc(size_t size, size_t alignSize = 1, uint flags = MEMORY_ALLOC_DEFAULT);
+void HeapMemoryFree(void *ptr);
 }
 void MemoryFree(void *ptr);
 
@@ -57,9 +66,9 @@ void MemoryCopy(void *dest, const void *src, int size);
 void MemoryMove(void *dest, const void *src, int size);
 uint MemoryHash(const void *data, int length);
 
-template<typename T> FORCE_INLINE T *MemoryAlloc(size_t size, size_t alignSize = 1)
+template<typename T> FORCE_INLINE T *MemoryAlloc(size_t size, size_t alignSize = 1, uint flags = MEMORY_ALLOC_DEFAULT)
 {
-    return static_cast<T *>(Internal::MemoryAlloc(sizeof(T) * size, alignSize));
+    return static_cast<T *>(Internal::MemoryAlloc(sizeof(T) * size, alignSize, flags));
 }
 
 // STRING
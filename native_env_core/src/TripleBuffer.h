@@ -19,15 +19,53 @@
 
 #include <pthread.h>
 #include "Base.h"
+#include "SystemCore.h"
+#include "SystemTimer.h"
+#include "Histogram.h"
 
 namespace System
 {
 
+/**
+ * Optional instrumentation of a TripleBuffer, see TripleBuffer::enableStatistics().
+ * All times are in milliseconds.
+ */
+struct TripleBufferStatistics
+{
+    TripleBufferStatistics(void)
+            : frameAge(0.001), overwrittenFrameCount(1.0), blockingWaitTime(0.001)
+    {
+    }
+
+    void reset(void)
+    {
+        frameAge.reset();
+        overwrittenFrameCount.reset();
+        blockingWaitTime.reset();
+    }
+
+    void log(char const *name) const
+    {
+        NativeLog(name);
+        frameAge.log("frame age (ms)");
+        overwrittenFrameCount.log("overwritten frames per acquire");
+        blockingWaitTime.log("blocking wait (ms)");
+    }
+
+    Histogram frameAge; // time from back buffer publish to front buffer acquire
+    Histogram overwrittenFrameCount; // publishes that were never read, counted at each acquire
+    Histogram blockingWaitTime; // time spent in blocking trySwapAndGet*() calls
+};
+
 /**
  * Provides a thread-safe implementation of triple buffering mechanism.
  * We use triple buffering to minimize the synchronization between Java
  * UI and image capture code. It allows us to capture images and perform UI
  * refresh always at their full speeds (30hz camera, ~60hz UI).
+ *
+ * The producer can fill the back buffer in place with getWritableBackBuffer()
+ * and publishBackBuffer(), while the consumer only ever sees the front buffer
+ * as read-only. Large payloads are then written exactly once.
  */
 
 template<class T> class TripleBuffer
@@ -39,16 +77,17 @@ public:
     template<typename U> TripleBuffer(U const &front, U const &back, U const &spare)
             : mFrontBuffer(front), mBackBuffer(back), mSpareBuffer(spare)
     {
-        pthread_mutex_init(&mSwapWaitLock, 0);
-        pthread_cond_init(&mSwapSignal, 0);
-
-        mFinalized = false;
-
-        mBufferPtr[0] = &mFrontBuffer;
-        mBufferPtr[1] = &mBackBuffer;
-        mBufferPtr[2] = &mSpareBuffer;
+        init();
+    }
 
-        mSpareBufferOrigin = 2;
+    /**
+     * Constructs all three buffers with the default constructor of T. Meant
+     * for buffers filled in place through getWritableBackBuffer().
+     */
+    TripleBuffer(void)
+            : mFrontBuffer(), mBackBuffer(), mSpareBuffer()
+    {
+        init();
     }
 
     /**
@@ -64,6 +103,8 @@ public:
 
         pthread_mutex_destroy(&mSwapWaitLock);
         pthread_cond_destroy(&mSwapSignal);
+
+        delete mInstrumentation;
     }
 
     /*
@@ -112,7 +153,7 @@ public:
 
     T const &trySwapAndGetFrontBuffer(bool blocking, bool *swapSuccessful = 0)
     {
-        T const *rbuffer;
+        T *rbuffer;
 
         bool swapResult = trySwapAndGetBuffer(0, blocking, &rbuffer);
         if (swapSuccessful != 0)
@@ -144,7 +185,45 @@ public:
 
     T const &trySwapAndGetBackBuffer(bool blocking, bool *swapSuccessful = 0)
     {
-        T const *rbuffer;
+        T *rbuffer;
+
+        bool swapResult = trySwapAndGetBuffer(1, blocking, &rbuffer);
+        if (swapSuccessful != 0)
+        {
+            *swapSuccessful = swapResult;
+        }
+
+        return *rbuffer;
+    }
+
+    /**
+     * Gets the back buffer for writing in place. Only the producer may call
+     * it; the reference is valid till the next publishBackBuffer() call.
+     * @return writable back buffer
+     */
+    T &getWritableBackBuffer(void)
+    {
+        return getBuffer(1);
+    }
+
+    /**
+     * Publishes the filled back buffer (same as swapBackBuffer()) and hands
+     * the producer the next buffer to fill.
+     * @return writable back buffer
+     */
+    T &publishBackBuffer(void)
+    {
+        return swapBuffer(1);
+    }
+
+    /**
+     * Publishes the filled back buffer only if the consumer has picked up the
+     * previously published one, see trySwapAndGetBackBuffer().
+     * @return writable back buffer
+     */
+    T &tryPublishBackBuffer(bool blocking, bool *swapSuccessful = 0)
+    {
+        T *rbuffer;
 
         bool swapResult = trySwapAndGetBuffer(1, blocking, &rbuffer);
         if (swapSuccessful != 0)
@@ -155,11 +234,88 @@ public:
         return *rbuffer;
     }
 
+    /**
+     * Enables or disables the collection of frame age, overwritten frame and
+     * blocking wait histograms. Disabled by default, in which case the swaps
+     * do not touch the timer at all. Disabling drops the collected data.
+     * @param enable - true to start collecting statistics
+     */
+    void enableStatistics(bool enable)
+    {
+        pthread_mutex_lock(&mSwapWaitLock);
+        if (enable && mInstrumentation == 0)
+        {
+            mInstrumentation = new Instrumentation();
+        }
+        else if (!enable && mInstrumentation != 0)
+        {
+            delete mInstrumentation;
+            mInstrumentation = 0;
+        }
+        pthread_mutex_unlock(&mSwapWaitLock);
+    }
+
+    /**
+     * Takes a snapshot of the collected statistics.
+     * @param statistics - receives the snapshot
+     * @return false if the statistics are not enabled
+     */
+    bool getStatistics(TripleBufferStatistics &statistics)
+    {
+        pthread_mutex_lock(&mSwapWaitLock);
+        bool const rval = mInstrumentation != 0;
+        if (rval)
+        {
+            statistics = mInstrumentation->statistics;
+        }
+        pthread_mutex_unlock(&mSwapWaitLock);
+
+        return rval;
+    }
+
+    void resetStatistics(void)
+    {
+        pthread_mutex_lock(&mSwapWaitLock);
+        if (mInstrumentation != 0)
+        {
+            mInstrumentation->statistics.reset();
+            mInstrumentation->overwrittenFrameCount = 0;
+        }
+        pthread_mutex_unlock(&mSwapWaitLock);
+    }
+
 private:
     TripleBuffer(TripleBuffer const &);
     TripleBuffer &operator=(TripleBuffer const &);
 
-    T const &getBuffer(int bufferIndex)
+    struct Instrumentation
+    {
+        Instrumentation(void)
+                : publishTime(0.0), overwrittenFrameCount(0)
+        {
+        }
+
+        TripleBufferStatistics statistics;
+        double publishTime; // time of the most recent back buffer swap
+        int overwrittenFrameCount; // publishes since the last acquire that were never read
+    };
+
+    void init(void)
+    {
+        pthread_mutex_init(&mSwapWaitLock, 0);
+        pthread_cond_init(&mSwapSignal, 0);
+
+        mFinalized = false;
+        mInstrumentation = 0;
+
+        mBufferPtr[0] = &mFrontBuffer;
+        mBufferPtr[1] = &mBackBuffer;
+        mBufferPtr[2] = &mSpareBuffer;
+
+        mSpareBufferOrigin = 2;
+    }
+
+    T &getBuffer(int bufferIndex)
     {
         if (mFinalized)
         {
@@ -167,13 +323,48 @@ private:
         }
 
         pthread_mutex_lock(&mSwapWaitLock);
-        T const *rval = mBufferPtr[bufferIndex];
+        T *rval = mBufferPtr[bufferIndex];
         pthread_mutex_unlock(&mSwapWaitLock);
 
         return *rval;
     }
 
-    bool trySwapAndGetBuffer(int bufferIndex, bool blocking, T const **rbuffer)
+    // must be called with mSwapWaitLock held, right before the swap
+    void recordSwap(int bufferIndex)
+    {
+        if (mInstrumentation == 0)
+        {
+            return;
+        }
+
+        double const now = mTimer.get();
+        if (bufferIndex == 1)
+        {
+            if (mSpareBufferOrigin == 1)
+            {
+                // the previous frame is going back to the producer unread
+                mInstrumentation->overwrittenFrameCount++;
+            }
+            mInstrumentation->publishTime = now;
+        }
+        else if (mSpareBufferOrigin == 1)
+        {
+            mInstrumentation->statistics.frameAge.add(now - mInstrumentation->publishTime);
+            mInstrumentation->statistics.overwrittenFrameCount.add(mInstrumentation->overwrittenFrameCount);
+            mInstrumentation->overwrittenFrameCount = 0;
+        }
+    }
+
+    // must be called with mSwapWaitLock held
+    void recordBlockingWait(double waitStartTime)
+    {
+        if (mInstrumentation != 0 && waitStartTime >= 0.0)
+        {
+            mInstrumentation->statistics.blockingWaitTime.add(mTimer.get() - waitStartTime);
+        }
+    }
+
+    bool trySwapAndGetBuffer(int bufferIndex, bool blocking, T **rbuffer)
     {
         if (mFinalized)
         {
@@ -186,16 +377,21 @@ private:
         // blocking case
         if (blocking)
         {
+            double const waitStartTime = mInstrumentation != 0 ? mTimer.get() : -1.0;
+
             while (mSpareBufferOrigin != (1 - bufferIndex))
             {
                 if (mFinalized)
                 {
+                    recordBlockingWait(waitStartTime);
                     *rbuffer = mBufferPtr[bufferIndex];
                     pthread_mutex_unlock(&mSwapWaitLock);
                     return false;
                 }
                 pthread_cond_wait(&mSwapSignal, &mSwapWaitLock);
             }
+            recordBlockingWait(waitStartTime);
+            recordSwap(bufferIndex);
             NVR::xchg(mBufferPtr[bufferIndex], mBufferPtr[2]);
             mSpareBufferOrigin = bufferIndex;
             pthread_cond_broadcast(&mSwapSignal);
@@ -208,6 +404,7 @@ private:
         // non-blocking case
         if (!mFinalized && mSpareBufferOrigin == (1 - bufferIndex))
         {
+            recordSwap(bufferIndex);
             NVR::xchg(mBufferPtr[bufferIndex], mBufferPtr[2]);
             mSpareBufferOrigin = bufferIndex;
             pthread_cond_broadcast(&mSwapSignal);
@@ -222,7 +419,7 @@ private:
         return false;
     }
 
-    T const &swapBuffer(int bufferIndex)
+    T &swapBuffer(int bufferIndex)
     {
         if (mFinalized)
         {
@@ -233,27 +430,33 @@ private:
 
         if (!mFinalized)
         {
+            recordSwap(bufferIndex);
             NVR::xchg(mBufferPtr[bufferIndex], mBufferPtr[2]);
             mSpareBufferOrigin = bufferIndex;
             pthread_cond_broadcast(&mSwapSignal);
         }
 
-        T const *rval = mBufferPtr[bufferIndex];
+        T *rval = mBufferPtr[bufferIndex];
         pthread_mutex_unlock(&mSwapWaitLock);
 
         return *rval;
     }
 
-    T const mFrontBuffer;
-    T const mBackBuffer;
-    T const mSpareBuffer;
+    T mFrontBuffer;
+    T mBackBuffer;
+    T mSpareBuffer;
     int mSpareBufferOrigin; // index of the buffer that spare buffer is from (most recently)
 
-    T const *mBufferPtr[3];
+    T *mBufferPtr[3];
 
     pthread_mutex_t mSwapWaitLock;
     pthread_cond_t mSwapSignal;
     bool mFinalized;
+
+    Instrumentation *mInstrumentation; // null unless statistics are enabled
+    // clock of the statistics, outlives the instrumentation so that a wait
+    // spanning enableStatistics() is measured against the same clock
+    Timer mTimer;
 };
 
 }
@@ -18,6 +18,7 @@
 
 #include <pthread.h>
 #include <queue>
+#include "IntrusiveQueue.h"
 
 namespace System
 {
@@ -226,7 +227,195 @@ private:
     pthread_cond_t mEnqueueSignal;
 };
 
+/**
+ * Allocation-free variant of WorkQueue. Elements derive from
+ * NVR::IntrusiveQueueNode and carry their own link field, so produce()
+ * and consume() never touch the heap. The queue does not own its
+ * elements: they are typically allocated from a TypedBlockAllocator,
+ * and nodes still queued on finalize() or reset() are simply dropped.
+ */
+template<class T> class IntrusiveWorkQueue
+{
+public:
+    /**
+     * Default constructor.
+     */
+    IntrusiveWorkQueue(void)
+            : mFinalized(false), mDataQueue(), mAccessLock(), mEnqueueSignal()
+    {
+        pthread_mutex_init(&mAccessLock, 0);
+        pthread_cond_init(&mEnqueueSignal, 0);
+    }
+
+    /**
+     * Default destructor.
+     */
+    ~IntrusiveWorkQueue(void)
+    {
+        finalize();
+
+        // XXX: dirty hack, see ~WorkQueue()
+        pthread_mutex_lock(&mAccessLock);
+        pthread_mutex_unlock(&mAccessLock);
+
+        pthread_cond_destroy(&mEnqueueSignal);
+        pthread_mutex_destroy(&mAccessLock);
+    }
+
+    /**
+     * Cancel all pending consume requests, flush queue,
+     * and stop taking new tasks.
+     */
+    void finalize(void)
+    {
+        if (mFinalized)
+        {
+            return;
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+        mFinalized = true;
+        mDataQueue.clear();
+        pthread_cond_broadcast(&mEnqueueSignal);
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    /**
+     * Resets the queue to its initial state.
+     */
+    void reset(void)
+    {
+        pthread_mutex_lock(&mAccessLock);
+        mFinalized = false;
+        mDataQueue.clear();
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    /**
+     * Returns true is queue is in finalized state, false otherwise.
+     */
+    bool isFinalized(void)
+    {
+        return mFinalized;
+    }
+
+    /**
+     * Adds a new element to the end of the queue.
+     * @param elem element to be linked into the queue
+     */
+    void produce(T *elem)
+    {
+        if (mFinalized)
+        {
+            return;
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+        if (!mFinalized)
+        {
+            bool const wasEmpty = mDataQueue.empty();
+            mDataQueue.push(elem);
+            if (wasEmpty)
+            {
+                pthread_cond_broadcast(&mEnqueueSignal);
+            }
+        }
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    /**
+     * Moves a chain of elements to the end of the queue. The chain is
+     * left empty.
+     * @param chain elements to be linked into the queue
+     */
+    void produceAll(NVR::IntrusiveQueue<T> &chain)
+    {
+        if (mFinalized || chain.empty())
+        {
+            return;
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+        if (!mFinalized)
+        {
+            bool const wasEmpty = mDataQueue.empty();
+            mDataQueue.pushAll(chain);
+            if (wasEmpty)
+            {
+                pthread_cond_broadcast(&mEnqueueSignal);
+            }
+        }
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    /**
+     * Removes an element from the queue. Blocking behavior is the same
+     * as in WorkQueue::consume().
+     * @param elem receives the element from the top of the queue
+     * @param blocking determines whether the call should block until an
+     * element is available
+     * @return false if failed to get element from queue
+     */
+    bool consume(T *&elem, bool blocking = true)
+    {
+        if (mFinalized)
+        {
+            return false;
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+        while (mDataQueue.empty())
+        {
+            if (!blocking || mFinalized)
+            {
+                pthread_mutex_unlock(&mAccessLock);
+                return false;
+            }
+            pthread_cond_wait(&mEnqueueSignal, &mAccessLock);
+        }
+
+        elem = mDataQueue.pop();
+        pthread_mutex_unlock(&mAccessLock);
+
+        return true;
+    }
+
+    /**
+     * Moves the contents of this queue to the end of another queue.
+     * The function is non-blocking.
+     */
+    void consumeAll(NVR::IntrusiveQueue<T> &queue)
+    {
+        if (mFinalized)
+        {
+            return;
+        }
+
+        pthread_mutex_lock(&mAccessLock);
+        queue.pushAll(mDataQueue);
+        pthread_mutex_unlock(&mAccessLock);
+    }
+
+    /**
+     * Returns the number of elements in this work queue.
+     * @return number of elements in this work queue
+     */
+    int size(void)
+    {
+        return mDataQueue.size();
+    }
+
+private:
+    // prevent copy construction and assignment
+    IntrusiveWorkQueue(IntrusiveWorkQueue const &instance);
+    IntrusiveWorkQueue &operator=(IntrusiveWorkQueue const &instance);
+
+    bool mFinalized;
+    NVR::IntrusiveQueue<T> mDataQueue;
+    pthread_mutex_t mAccessLock;
+    pthread_cond_t mEnqueueSignal;
+};
+
 }
 
 #endif
-